@@ -0,0 +1,202 @@
+import { ABI, Serializer, TimePointSec } from "@greymass/eosio";
+import { Blockchain, mintTokens } from "@proton/vert";
+import { performance } from "perf_hooks";
+
+// measures the cost of the batch actions against the number of assets (or templates) they handle
+// prints one JSON object per line: { action, mode, batch, ram_delta, action_size, ms, error? }
+//
+// the RAM delta only covers the contract's own tables, it's computed from the serialized rows
+// with the same overheads as the Storage section of the README
+
+const blockchain = new Blockchain();
+const [dummycol, alice] = blockchain.createAccounts("dummycol", "alice");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const eosioTokenContract = blockchain.createContract("eosio.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+const BATCH_SIZES = (process.env.BATCH_SIZES || "1,10,50,100,250,500,1000").split(",").map(Number);
+const MODES = [
+	{ name: "per-asset", reward_mode: 0 },
+	{ name: "accrual", reward_mode: 1 },
+];
+
+const FIRST_ASSET_ID = 1099511627776n;
+
+const ROW_OVERHEAD = 108;
+
+// the billable size of the secondary indexes of each table
+const INDEX_OVERHEAD: { [table: string]: number } = {
+	users: 128,
+	leaders: 128,
+	assets: 128 + 136,
+	buckets: 136,
+	counts: 136 + 136,
+	slots: 128,
+};
+
+type Measure = {
+	action: string;
+	mode: string;
+	batch: number;
+	ram_delta: number;
+	action_size: number;
+	ms: number;
+	error?: string;
+};
+
+function ramUsage(): number {
+	const abi = ABI.from(ezstakeContract.abi);
+	const contractStorage = blockchain.getStorage()[ezstakeContract.name.toString()] || {};
+
+	let bytes = 0;
+
+	for (const [table, scopes] of Object.entries<any>(contractStorage)) {
+		const type = abi.tables.find((t) => t.name.toString() === table).type;
+
+		for (const rows of Object.values<any[]>(scopes)) {
+			for (const row of rows) {
+				bytes += ROW_OVERHEAD + (INDEX_OVERHEAD[table] || 0) + Serializer.encode({ object: row.value, type, abi }).array.length;
+			}
+		}
+	}
+
+	return bytes;
+}
+
+function actionSize(contract: typeof ezstakeContract, action: string, args: any[]): number {
+	const abi = ABI.from(contract.abi);
+	const type = abi.actions.find((a) => a.name.toString() === action).type;
+	const fields = abi.structs.find((s) => s.name === type).fields;
+
+	const object = Object.fromEntries(fields.map((field, i) => [field.name, args[i]]));
+
+	return Serializer.encode({ object, type, abi }).array.length;
+}
+
+async function measure(action: string, mode: string, batch: number, contract: typeof ezstakeContract, args: any[], auth?: string): Promise<Measure> {
+	const result: Measure = { action, mode, batch, ram_delta: 0, action_size: actionSize(contract, action, args), ms: 0 };
+	const ramBefore = ramUsage();
+	const start = performance.now();
+
+	try {
+		await contract.actions[action](args).send(auth);
+	} catch (e) {
+		result.error = e.message;
+	}
+
+	result.ms = Number((performance.now() - start).toFixed(3));
+	result.ram_delta = ramUsage() - ramBefore;
+
+	console.log(JSON.stringify(result));
+
+	return result;
+}
+
+async function createDummyCollection(templates: number, assets: number) {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < templates; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				0,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint the assets from template 1 to alice
+	for (let i = 0; i < assets; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+}
+
+// stake, claim, unstake and reset a batch of assets in the given mode
+async function benchStakeCycle(mode: typeof MODES[number], batch: number) {
+	blockchain.resetTables();
+
+	await ezstakeContract.actions.setconfig([600, 3600]).send();
+
+	if (mode.reward_mode != 0) {
+		await ezstakeContract.actions.setmode([mode.reward_mode]).send();
+	}
+
+	await createDummyCollection(1, batch);
+	await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+	await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "0.00000001 WAX" }]]).send();
+	await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+	const assetIds = Array.from({ length: batch }, (_, i) => (FIRST_ASSET_ID + BigInt(i)).toString());
+
+	blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+	await measure("transfer", mode.name, batch, atomicassetsContract, ["alice", "ezstake", assetIds, "stake"], "alice@active");
+
+	// the per-user modes claim the whole balance, the asset ids are only checked in the per-asset mode
+	blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+	await measure("claim", mode.name, batch, ezstakeContract, ["alice", mode.reward_mode == 0 ? assetIds : []], "alice@active");
+
+	blockchain.setTime(TimePointSec.fromString("2022-01-01T02:00:00"));
+	await measure("unstake", mode.name, batch, ezstakeContract, ["alice", assetIds], "alice@active");
+
+	// stake them again to measure the reset
+	await atomicassetsContract.actions.transfer(["alice", "ezstake", assetIds, "stake"]).send("alice@active");
+	await measure("resetuser", mode.name, batch, ezstakeContract, ["alice"]);
+}
+
+// add a batch of templates at once
+async function benchAddTemplates(batch: number) {
+	blockchain.resetTables();
+
+	await ezstakeContract.actions.setconfig([600, 3600]).send();
+	await createDummyCollection(batch, 0);
+
+	const templates = Array.from({ length: batch }, (_, i) => ({ template_id: i + 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }));
+
+	await measure("addtemplates", "any", batch, ezstakeContract, [templates]);
+}
+
+async function main() {
+	for (const batch of BATCH_SIZES) {
+		for (const mode of MODES) {
+			await benchStakeCycle(mode, batch);
+		}
+
+		await benchAddTemplates(batch);
+	}
+}
+
+main().catch((e) => {
+	console.error(e);
+	process.exit(1);
+});
@@ -1,8 +1,41 @@
+#pragma once
+
 #include "atomicassets-interface.hpp"
 #include <eosio/asset.hpp>
 #include <eosio/eosio.hpp>
 #include <eosio/singleton.hpp>
 
+#include <algorithm>
+#include <optional>
+
+// number of users kept in the leaderboard table, which replaces the users' rate index
+// 0 (the default) keeps the rate index, build with -DLEADERBOARD_SIZE=100 for a top 100
+#ifndef LEADERBOARD_SIZE
+#define LEADERBOARD_SIZE 0
+#endif
+
+// bakes the token and the claim/unstake periods in instead of reading them from the config singleton
+// build with -DFIXED_CONFIG -DFIXED_TOKEN_CONTRACT=eosio.token -DFIXED_TOKEN_SYMBOL=WAX -DFIXED_TOKEN_PRECISION=8 -DFIXED_MIN_CLAIM_PERIOD=600 -DFIXED_UNSTAKE_PERIOD=259200
+// setconfig and settoken are left out, is_frozen and the modes stay in the config singleton
+#ifndef FIXED_CONFIG
+#define FIXED_CONFIG 0
+#endif
+
+#if FIXED_CONFIG
+#if !defined(FIXED_TOKEN_CONTRACT) || !defined(FIXED_TOKEN_SYMBOL) || !defined(FIXED_TOKEN_PRECISION) || !defined(FIXED_MIN_CLAIM_PERIOD) || !defined(FIXED_UNSTAKE_PERIOD)
+#error "FIXED_CONFIG requires FIXED_TOKEN_CONTRACT, FIXED_TOKEN_SYMBOL, FIXED_TOKEN_PRECISION, FIXED_MIN_CLAIM_PERIOD and FIXED_UNSTAKE_PERIOD"
+#endif
+
+#define EZSTAKE_STRINGIFY(x) #x
+#define EZSTAKE_STRING(x) EZSTAKE_STRINGIFY(x)
+#endif
+
+// fails with the formatted messages instead of the numeric error codes (see error_code_t)
+// the messages pull the string formatting into the WASM, build with -DVERBOSE_ERRORS for the tests and the debugging
+#ifndef VERBOSE_ERRORS
+#define VERBOSE_ERRORS 0
+#endif
+
 using namespace eosio;
 
 CONTRACT ezstake : public contract
@@ -10,6 +43,65 @@ CONTRACT ezstake : public contract
 public:
     using contract::contract;
 
+    // ------------ enums ------------
+
+    // how the generated rewards are accounted
+    enum reward_mode_t : uint8_t {
+        // rewards are computed per asset from their last claim (default)
+        PER_ASSET = 0,
+        // rewards are accrued per user from their total hourly_rate
+        // claiming only touches the user row no matter how many assets are staked
+        ACCRUAL = 1,
+        // a fixed hourly_emission is shared by all the staked assets according to their hourly_rate (their power)
+        // rewards are tracked with a global reward per power accumulator and a reward debt per user
+        POOL = 2,
+    };
+
+    // how the staked assets are stored
+    enum storage_mode_t : uint8_t {
+        // one row per staked asset in the assets table (default)
+        ROWS = 0,
+        // the assets of a user are packed into fixed-capacity rows of the buckets table
+        // requires a per-user reward mode (accrual or pool), as the entries don't keep a claim time per asset
+        BUCKETS = 1,
+    };
+
+    // who pays for the RAM of the staked assets rows
+    // a row keeps the payer it was created with, none of the actions move it to another account
+    enum ram_mode_t : uint8_t {
+        // the contract pays for every row (default)
+        CONTRACT_RAM = 0,
+        // the users pay for their assets rows out of the RAM they deposited beforehand (see depositram)
+        // requires the rows storage, the buckets are shared by the assets of a user and always paid by the contract
+        USER_RAM = 1,
+    };
+
+    // the failures about a given user, asset or template
+    // they're reported as a numeric code, the error in the upper 16 bits and the id in the lower 48 bits
+    // (the asset id, the template id or the bytes, 0 for the names), see errors.json for the messages
+    enum error_code_t : uint16_t {
+        USER_NOT_AUTHORIZED = 1,
+        USER_NOT_REGISTERED = 2,
+        USER_ALREADY_REGISTERED = 3,
+        USER_IN_COOLDOWN = 4,
+        ASSET_NOT_FOUND = 5,
+        ASSET_NOT_STAKEABLE = 6,
+        ASSET_NOT_STAKED = 7,
+        ASSET_NOT_OWNED = 8,
+        ASSET_IN_COOLDOWN = 9,
+        ASSET_LOCKED = 10,
+        ASSET_DUPLICATED = 11,
+        TEMPLATE_NOT_FOUND = 12,
+        TEMPLATE_NOT_RERATING = 13,
+        TEMPLATE_RERATING = 14,
+        COLLECTION_NOT_FOUND = 15,
+        SCHEMA_NOT_FOUND = 16,
+        RULE_NOT_FOUND = 17,
+        RAM_NOT_DEPOSITED = 18,
+        RAM_NOT_WITHDRAWABLE = 19,
+        USER_RESETTING = 20,
+    };
+
     // ------------ structs ------------
 
     // public template struct for the addtemplates/rmtemplates actions
@@ -22,44 +114,287 @@ public:
         asset hourly_rate;
     };
 
+    // a staked asset returned by getstake
+    struct stake_item {
+        // id of the asset (from the atomicassets)
+        uint64_t asset_id;
+        // id of the template of the asset
+        int32_t template_id;
+        // timestamp of the stake or of the last claim
+        time_point_sec last_claim;
+    };
+
+    // pending rewards of a staked asset returned by getpending (per-asset mode)
+    struct pending_item {
+        // id of the asset (from the atomicassets)
+        uint64_t asset_id;
+        // the rewards claimable for this asset, 0 if its template was removed
+        asset pending;
+        // timestamp from which the asset is out of cooldown
+        time_point_sec claimable_at;
+    };
+
+    // result of getpending
+    struct pending_result {
+        // the rewards claimall would pay for this page (per-asset mode) or everything the user accrued (per-user modes)
+        asset total;
+        // timestamp from which the user is out of cooldown (per-user modes)
+        time_point_sec claimable_at;
+        // the page of assets (per-asset mode only)
+        vector<pending_item> assets;
+        // the asset id to read the next page from, 0 if there's no assets left
+        uint64_t next;
+        // the rewards accrued in the extra tokens, paid along with the next claim
+        vector<extended_asset> extras;
+    };
+
+    // result of getstake
+    struct stake_result {
+        // the page of staked assets
+        vector<stake_item> assets;
+        // the asset id to read the next page from, 0 if there's no assets left
+        uint64_t next;
+    };
+
+    // the global stats, also returned by getstats
+    TABLE stats_s
+    {
+        // number of registered users
+        uint64_t users = 0;
+        // number of staked assets
+        uint64_t staked_assets = 0;
+        // the total hourly_rate of the users
+        uint64_t total_power = 0;
+        // total amount of tokens claimed
+        uint64_t total_claimed = 0;
+        // rewards accrued and not claimed yet up to last_update, in rate amount * seconds
+        // an estimate, as each claim rounds down and a rate change reaches the users on their next action
+        uint128_t liability = 0;
+        // timestamp of the last liability update
+        time_point_sec last_update;
+        // number of users in the leaderboard table (leaderboard builds only)
+        binary_extension<uint32_t> leaders;
+    };
+
     // ------------ admin actions ------------
 
     // freeze/unfreeze the contract
     ACTION setfrozen(const bool& is_frozen);
 
+#if !FIXED_CONFIG
     // set the contract config
     ACTION setconfig(const uint32_t& min_claim_period, const uint32_t& unstake_period);
 
     // set the contract token config
     ACTION settoken(const name& contract, const symbol& symbol);
+#endif
+
+    // set the reward accounting mode
+    // switching from per-asset to accrual converts the users lazily, any other switch requires no staked assets
+    ACTION setmode(const uint8_t& reward_mode);
+
+    // set the total amount of tokens emitted per hour to the stakers (pool mode)
+    ACTION setemission(const asset& hourly_emission);
+
+    // set the minimum pending rewards for a user to be paid out by the crank action (per-user modes)
+    // 0 disables the auto-payout
+    ACTION setpayout(const asset& min_payout);
+
+    // set the rewards a template provides in other tokens than the config token, per hour per asset
+    // an empty list removes them, changing the rates of a staked template queues it for re-rating like a rate change
+    ACTION setextras(const int32_t& template_id, const vector<extended_asset>& extra_rates);
+
+    // set the staked assets storage mode
+    // switching to buckets while assets are staked requires the contract to be frozen until packassets is done
+    // switching back to rows requires no staked assets
+    ACTION setstorage(const uint8_t& storage_mode);
+
+    // set who pays for the RAM of the staked assets rows
+    // only applies to the rows created from then on, the existing ones keep their payer
+    ACTION setrammode(const uint8_t& ram_mode);
 
     // add the staking assets templates
+    // changing the rate of a template queues it for re-rating, see rerate
     ACTION addtemplates(const std::vector<template_item>& templates);
 
     // remove the staking assets templates
+    // the users staking them are queued for re-rating to a zero rate, run rerate to stop their rewards right away
+    // the templates covered by a rule are excluded from the rules until addtemplates gives them a rate of their own
     ACTION rmtemplates(const std::vector<template_item>& templates);
 
+    // stage templates to be added by commitimport, without checking them against atomicassets
+    // staging a template again replaces its staged rate and clears its previous rejection
+    ACTION stageimport(const std::vector<template_item>& templates);
+
+    // add at most `limit` staged templates like addtemplates, the invalid ones are moved to the "invalid" scope of the imports table
+    // prints the template to be committed next, or done
+    ACTION commitimport(const uint32_t& limit);
+
+    // set the rate of the templates of a collection (empty schema) or of one of its schemas
+    // a template without a rate of its own gets the rate of the most specific rule on its first stake
+    // a changed rule reaches the staked templates through syncrules
+    ACTION setrule(const name& collection, const name& schema, const asset& hourly_rate);
+
+    // remove a collection/schema rule, the staked templates lose it through syncrules
+    ACTION rmrule(const name& collection, const name& schema);
+
+    // define a set of templates, the users staking one asset of each get `boost` basis points more on the rate of these assets (per-user modes)
+    // the users already staking the set get their boost on their next stake/unstake of its templates, or through recount
+    ACTION addset(const uint64_t& set_id, const vector<int32_t>& template_ids, const uint16_t& boost);
+
+    // remove a set, its templates are unlinked on the first call and the boost is taken out of the rate of at most max_rows users per call
+    // prints "done" once the set is erased with its last user, call it again until then
+    ACTION rmset(const uint64_t& set_id, const uint32_t& max_rows);
+
+    // move the templates of a collection that got their rate from a rule to the current rules
+    // walks at most max_rows atomicassets templates starting from from_template and prints the template to resume from
+    ACTION syncrules(const name& collection, const int32_t& from_template, const uint32_t& max_rows);
+
     // unstake all assets & reset a user from the contract
     // used in cases of emergencies such as when a user can't unstake a removed template
     ACTION resetuser(const name& user);
 
+    // resumable version of resetuser for users with too many assets to reset in one transaction
+    // unstakes at most max_rows assets per call and removes the user after the last batch
+    // the user can't stake, claim or unstake until then
+    ACTION resetbatch(const name& user, const uint32_t& max_rows);
+
+    // migrate the assets staked by older versions of the contract
+    // caches their template_id/collection and adds them to the indexes created after they were staked
+    // iterates at most `limit` rows starting from `from_id` and prints the id to resume from, or done
+    // the actions walk the owner index until a run started from 0 is done, then the ownerasset index
+    ACTION backfill(const uint64_t& from_id, const uint32_t& limit);
+
+    // move the rows of the assets table into the buckets (bucket storage)
+    // moves at most `limit` rows per call and prints whether there's more rows left
+    ACTION packassets(const uint32_t& limit);
+
+    // move the hourly_rate of the users staking a template to the template's new rate, or to zero for a removed template
+    // the users are also re-rated lazily on their next action, this catches up the inactive ones
+    // walks at most max_rows users starting from from_user and prints the user to resume from
+    ACTION rerate(const int32_t& template_id, const name& from_user, const uint32_t& max_rows);
+
+    // rebuild the per-template counts and the hourly_rate of a user from their staked assets
+    // used for the users who staked before the counts were kept, the assets of removed templates aren't counted
+    ACTION recount(const name& user);
+
     // ------------ user actions ------------
 
     // register a new user
     ACTION regnewuser(const name& user);
 
+    // reserve RAM paid by the user for their future assets rows (user RAM mode)
+    // staking converts ASSET_ROW_RAM bytes of the deposit per asset into the asset's row, unstaking frees the row's RAM to the user
+    ACTION depositram(const name& user, const uint32_t& bytes);
+
+    // give back the unused RAM of the user's deposit
+    ACTION withdrawram(const name& user, const uint32_t& bytes);
+
     // claim the generated tokens
+    // in accrual and pool modes all of the user's rewards are claimed and asset_ids is ignored
     ACTION claim(const name& user, const vector<uint64_t>& asset_ids);
 
     // unstake the user's assets
     ACTION unstake(const name& user, const vector<uint64_t>& asset_ids);
 
+    // claim the generated tokens of all the user's assets
+    // walks at most max_rows assets starting from from_id, the assets still in cooldown are skipped
+    // prints the asset id to resume from if there's more assets left
+    ACTION claimall(const name& user, const uint64_t& from_id, const uint32_t& max_rows);
+
+    // unstake all the user's assets
+    // walks at most max_rows assets starting from from_id, the assets that can't be unstaked yet are skipped
+    // prints the asset id to resume from if there's more assets left
+    ACTION unstakeall(const name& user, const uint64_t& from_id, const uint32_t& max_rows);
+
+    // pay out the users whose pending rewards reached min_payout, like their own claim would (auto-payout, per-user modes)
+    // anyone can call it, walks at most max_users users from where the previous call stopped, wrapping around
+    // the accrual users without a checkpoint in the current mode are skipped, so each user costs a single row read
+    ACTION crank(const uint32_t& max_users);
+
+    // ------------ log actions ------------
+
+    // no-op actions sent inline by the contract, so the indexers can follow it from the action traces alone
+    // each carries the user's new hourly_rate and the new total power of the contract
+
+    // assets staked by the user, `added_rate` is the rate they added
+    ACTION logstake(const name& user, const vector<uint64_t>& asset_ids, const asset& added_rate, const asset& hourly_rate, const uint64_t& total_power);
+
+    // tokens claimed by the user, `asset_ids` are the claimed assets (per-asset mode only)
+    ACTION logclaim(const name& user, const vector<uint64_t>& asset_ids, const asset& claimed, const asset& hourly_rate, const uint64_t& total_power);
+
+    // assets unstaked by the user, `removed_rate` is the rate they removed
+    ACTION logunstake(const name& user, const vector<uint64_t>& asset_ids, const asset& removed_rate, const asset& hourly_rate, const uint64_t& total_power);
+
+    // assets returned by resetuser/resetbatch, `forfeited` are the lost unclaimed rewards
+    ACTION logreset(const name& user, const vector<uint64_t>& asset_ids, const asset& forfeited, const asset& hourly_rate, const uint64_t& total_power);
+
+    // ------------ read-only actions ------------
+
+    // get the rewards the user can claim right now, using the same computation as claim/claimall
+    // reads at most `limit` assets starting from `cursor` in per-asset mode
+    [[eosio::action, eosio::read_only]] pending_result getpending(const name& user, const uint64_t& cursor, const uint32_t& limit);
+
+    // get a page of the user's staked assets, reads at most `limit` assets starting from `cursor`
+    [[eosio::action, eosio::read_only]] stake_result getstake(const name& user, const uint64_t& cursor, const uint32_t& limit);
+
+    // get the global stats, with the liability moved to now
+    [[eosio::action, eosio::read_only]] stats_s getstats();
+
     // ------------ notify handlers ------------
 
     // receiver assets from the user
     void receiveassets(name from, name to, vector<uint64_t> asset_ids, string memo);
 
 private:
+    // the host-native simulation (sim/) checks its invariants on the tables directly
+    friend struct ezstake_sim;
+    // the off-chain indexer (indexer/) decodes the table rows and reuses the reward math
+    friend struct ezstake_indexer;
+
+    // key of the owner/asset_id secondary index
+    static uint128_t owner_asset_key(const name& owner, const uint64_t& asset_id)
+    {
+        return (uint128_t(owner.value) << 64) | asset_id;
+    }
+
+    // key of the template/user secondary index
+    static uint128_t template_user_key(const int32_t& template_id, const name& user)
+    {
+        return (uint128_t(uint64_t(template_id)) << 64) | user.value;
+    }
+
+    static uint128_t set_user_key(const uint64_t& set_id, const name& user)
+    {
+        return (uint128_t(set_id) << 64) | user.value;
+    }
+
+    // fixed point precision of the pool's reward per power accumulator
+    static constexpr uint64_t REWARD_PRECISION = 1000000000000;
+
+    // maximum number of entries in a bucket row
+    static constexpr uint32_t BUCKET_CAPACITY = 64;
+
+    // RAM billed for a row of the assets table: 108 bytes of row overhead, 32 bytes of data and 264 bytes for its two indexes
+    // a notification can only bill a user if their RAM usage doesn't grow, so the deposit shrinks by at least as much
+    static constexpr uint32_t ASSET_ROW_RAM = 404;
+
+    // maximum number of extra tokens of a template
+    static constexpr uint32_t MAX_EXTRA_TOKENS = 4;
+
+    // maximum number of templates of a set
+    static constexpr uint32_t MAX_SET_TEMPLATES = 16;
+
+    // a staked asset packed in a bucket (14 bytes)
+    struct bucket_entry {
+        // id of the asset (from the atomicassets)
+        uint64_t asset_id;
+        // slot of the asset's template (see slot_s)
+        uint16_t slot;
+        // timestamp (in seconds) of the stake, or of the last claim for the assets packed from the assets table
+        uint32_t time;
+    };
+
     // token stat struct
     // taken from the reference eosio.token contract
     struct stat_s {
@@ -76,6 +411,16 @@ private:
         name user;
         // the total hourly_rate this user has
         asset hourly_rate;
+        // rewards accrued until last_update (accrual and pool modes)
+        binary_extension<asset> accrued;
+        // timestamp of the last accrual checkpoint (accrual and pool modes)
+        binary_extension<time_point_sec> last_update;
+        // timestamp of the last claim (accrual and pool modes)
+        binary_extension<time_point_sec> last_claim;
+        // the pool's rewards already accounted for the user's current rate, times REWARD_PRECISION (pool mode)
+        binary_extension<uint128_t> reward_debt;
+        // the config's mode_switches when the checkpoint was set, the checkpoint is stale once the mode is switched
+        binary_extension<uint32_t> mode_switch;
 
         auto primary_key() const { return user.value; }
         // secondary index to sort/query the users by their rate
@@ -90,10 +435,17 @@ private:
         name owner;
         // timestamp of the last claim
         time_point_sec last_claim;
+        // id of the template of the asset (cached from the atomicassets on stake)
+        binary_extension<int32_t> template_id;
+        // name of the collection of the asset (cached from the atomicassets on stake)
+        binary_extension<name> collection;
 
         auto primary_key() const { return asset_id; }
         // secondary index to sort/query assets by their owner
         uint64_t by_owner() const { return owner.value; }
+        // secondary index to sort/query assets by their owner then by their id
+        // used to paginate through a user's assets from a cursor
+        uint128_t by_owner_asset() const { return owner_asset_key(owner, asset_id); }
     };
 
     TABLE template_s
@@ -104,10 +456,207 @@ private:
         name collection;
         // the staking power provided by this template
         asset hourly_rate;
+        // number of assets of this template currently staked
+        binary_extension<uint64_t> staked;
+        // whether the rate comes from a collection/schema rule, the row was then added by the first stake
+        binary_extension<bool> from_rule;
+        // the rewards provided by this template in other tokens than the config token (see setextras)
+        binary_extension<vector<extended_asset>> extra_rates;
+
+        auto primary_key() const { return uint64_t(template_id); }
+    };
+
+    // scoped by the contract for the staged templates, by "invalid" for the ones commitimport rejected
+    TABLE import_s
+    {
+        // id of the template (from the atomicassets)
+        int32_t template_id;
+        // name of the collection of this template
+        name collection;
+        // the staking power provided by this template
+        asset hourly_rate;
+        // why commitimport rejected the template (an error_code_t, see errors.json), 0 while staged
+        uint16_t error;
+
+        auto primary_key() const { return uint64_t(template_id); }
+    };
+
+    // scoped by collection
+    TABLE rule_s
+    {
+        // name of the schema, empty for the rule of the whole collection
+        name schema;
+        // the staking power provided by the templates without a rate of their own
+        asset hourly_rate;
+
+        auto primary_key() const { return schema.value; }
+    };
+
+    // scoped by collection, the templates removed by rmtemplates while a rule covered them
+    TABLE exclusion_s
+    {
+        // id of the template (from the atomicassets)
+        int32_t template_id;
 
         auto primary_key() const { return uint64_t(template_id); }
     };
 
+    TABLE bucket_s
+    {
+        // id of the bucket
+        uint64_t id;
+        // name of the owner of the assets
+        name owner;
+        // lowest asset id this bucket holds, the bucket holds the ids up to the lo_id of the owner's next bucket
+        uint64_t lo_id;
+        // the staked assets, sorted by asset_id
+        vector<bucket_entry> entries;
+
+        auto primary_key() const { return id; }
+        // secondary index to find the bucket of an asset of the owner
+        uint128_t by_owner_range() const { return owner_asset_key(owner, lo_id); }
+    };
+
+    TABLE slot_s
+    {
+        // compact id of the template used by the bucket entries
+        uint64_t slot;
+        // id of the template (from the atomicassets)
+        int32_t template_id;
+
+        auto primary_key() const { return slot; }
+        // secondary index to find the slot of a template
+        uint64_t by_template() const { return uint64_t(template_id); }
+    };
+
+    TABLE count_s
+    {
+        // id of the row
+        uint64_t id;
+        // name of the user
+        name user;
+        // id of the template (from the atomicassets)
+        int32_t template_id;
+        // number of assets of this template staked by the user
+        uint64_t count;
+        // the template rate the user's hourly_rate currently includes for these assets
+        asset hourly_rate;
+        // the template extra rates the user's extra rates currently include for these assets
+        binary_extension<vector<extended_asset>> extra_rates;
+
+        auto primary_key() const { return id; }
+        // secondary index to find the count of a user's template
+        uint128_t by_user_template() const { return owner_asset_key(user, uint64_t(template_id)); }
+        // secondary index to find the users staking a template
+        uint128_t by_template_user() const { return template_user_key(template_id, user); }
+    };
+
+    TABLE rerate_s
+    {
+        // id of a template whose rate changed while some users still have the old rate
+        int32_t template_id;
+
+        auto primary_key() const { return uint64_t(template_id); }
+    };
+
+    TABLE set_s
+    {
+        // id of the set
+        uint64_t set_id;
+        // the templates of the set, a complete set is one staked asset of each
+        vector<int32_t> template_ids;
+        // bonus on the rate of each complete set, in basis points (1000 is +10%)
+        uint16_t boost;
+
+        auto primary_key() const { return set_id; }
+    };
+
+    // scoped by template_id, the sets the template is part of
+    TABLE setlink_s
+    {
+        // id of the set
+        uint64_t set_id;
+
+        auto primary_key() const { return set_id; }
+    };
+
+    // the sets the users completed (per-user modes)
+    TABLE boost_s
+    {
+        // id of the row
+        uint64_t id;
+        // name of the user
+        name user;
+        // id of the set
+        uint64_t set_id;
+        // number of complete sets staked by the user
+        uint64_t complete;
+        // the bonus the user's hourly_rate currently includes for this set
+        asset bonus_rate;
+
+        auto primary_key() const { return id; }
+        // secondary index to find the boost of a user's set
+        uint128_t by_user_set() const { return owner_asset_key(user, set_id); }
+        // secondary index to find the users boosted by a set
+        uint128_t by_set_user() const { return set_user_key(set_id, user); }
+    };
+
+    // scoped by template_id
+    TABLE epoch_s
+    {
+        // timestamp from which the rate applies
+        time_point_sec start;
+        // the staking power provided by the template from `start`
+        asset hourly_rate;
+        // reward generated by one asset of the template from the beginning up to `start`, in rate amount * seconds
+        uint128_t integral;
+
+        auto primary_key() const { return uint64_t(start.sec_since_epoch()); }
+    };
+
+    TABLE reset_s
+    {
+        // name of the user being reset
+        name user;
+        // number of assets already sent back to the user
+        uint64_t processed;
+        // timestamp of the first batch
+        time_point_sec started;
+        // whether the forfeited rewards are counted per asset, in per-asset mode or for an accrual user without a checkpoint
+        bool is_per_asset;
+
+        auto primary_key() const { return user.value; }
+    };
+
+    // the RAM deposited by a user (user RAM mode), billed to the user
+    TABLE ramdeposit_s
+    {
+        // name of the user
+        name user;
+        // padding whose size is the number of deposited bytes left
+        vector<char> reserved;
+
+        auto primary_key() const { return user.value; }
+    };
+
+    // the extra token rewards of a user, only the users who staked templates with extra rates have one
+    // the extra tokens are always accrued per user, whatever the reward mode
+    TABLE reward_s
+    {
+        // name of the user
+        name user;
+        // the total extra rates of the user's staked assets, one per token
+        vector<extended_asset> hourly_rates;
+        // rewards accrued until last_update, one per token
+        vector<extended_asset> accrued;
+        // timestamp of the last accrual checkpoint
+        time_point_sec last_update;
+        // timestamp of the last payout of the extra tokens
+        time_point_sec last_claim;
+
+        auto primary_key() const { return user.value; }
+    };
+
     TABLE config
     {
         // is the contract frozen/stopped for maintenance/emergency
@@ -120,39 +669,421 @@ private:
         uint32_t min_claim_period = 600;
         // the minimum time (in seconds) that a user is required to wait until they can unstake their assets
         uint32_t unstake_period = 86400 * 3;
+        // the reward accounting mode (see reward_mode_t)
+        binary_extension<uint8_t> reward_mode;
+        // the staked assets storage mode (see storage_mode_t)
+        binary_extension<uint8_t> storage_mode;
+        // the total amount of tokens emitted per hour to the stakers (pool mode)
+        // kept with the extensions as the config rows of older versions don't have it
+        binary_extension<asset> hourly_emission;
+        // the minimum pending rewards for the crank to pay a user out, 0 when the auto-payout is disabled
+        binary_extension<asset> min_payout;
+        // who pays for the RAM of the staked assets rows (see ram_mode_t)
+        binary_extension<uint8_t> ram_mode;
+        // the number of reward mode switches, to tell the user checkpoints set in an earlier mode
+        binary_extension<uint32_t> mode_switches;
+        // is every staked asset row in the ownerasset index, set once backfill is done
+        binary_extension<bool> is_indexed;
+    };
+
+    TABLE pool_s
+    {
+        // reward generated per unit of power since the pool started, times REWARD_PRECISION
+        uint128_t acc_reward_per_power = 0;
+        // the total hourly_rate of the users
+        uint64_t total_power = 0;
+        // timestamp of the last accumulator update
+        time_point_sec last_update;
     };
 
+    // the auto-payout progress
+    TABLE payout_s
+    {
+        // the user the next crank starts from
+        name cursor;
+    };
+
+#if LEADERBOARD_SIZE > 0
+    // the users with the highest hourly_rate (leaderboard builds only)
+    TABLE leader_s
+    {
+        // name of the user
+        name user;
+        // the user's hourly_rate amount
+        uint64_t hourly_rate;
+
+        auto primary_key() const { return user.value; }
+        // secondary index to sort the leaders by their rate, the lowest one is evicted first
+        uint64_t by_rate() const { return hourly_rate; }
+    };
+#endif
+
     // token stat table definition
     typedef multi_index<name("stat"), stat_s> stat_t;
 
+#if LEADERBOARD_SIZE > 0
+    // the leaderboard table replaces the rate index, which is rewritten on every stake/unstake
+    typedef multi_index<name("users"), user_s> user_t;
+
+    typedef multi_index<name("leaders"), leader_s,
+        indexed_by<name("rate"), const_mem_fun<leader_s, uint64_t, &leader_s::by_rate>>>
+        leader_t;
+#else
     typedef multi_index<name("users"), user_s,
         indexed_by<name("rate"), const_mem_fun<user_s, uint64_t, &user_s::by_rate>>>
         user_t;
+#endif
 
     typedef multi_index<name("assets"), asset_s,
-        indexed_by<name("owner"), const_mem_fun<asset_s, uint64_t, &asset_s::by_owner>>>
+        indexed_by<name("owner"), const_mem_fun<asset_s, uint64_t, &asset_s::by_owner>>,
+        indexed_by<name("ownerasset"), const_mem_fun<asset_s, uint128_t, &asset_s::by_owner_asset>>>
         asset_t;
 
     typedef multi_index<name("templates"), template_s> template_t;
+    typedef multi_index<name("rules"), rule_s> rule_t;
+    typedef multi_index<name("exclusions"), exclusion_s> exclusion_t;
+    typedef multi_index<name("imports"), import_s> import_t;
+    typedef multi_index<name("resets"), reset_s> reset_t;
+    typedef multi_index<name("ramdeposits"), ramdeposit_s> ramdeposit_t;
+    typedef multi_index<name("rewards"), reward_s> reward_t;
+    typedef multi_index<name("sets"), set_s> set_t;
+    typedef multi_index<name("setlinks"), setlink_s> setlink_t;
+    typedef multi_index<name("epochs"), epoch_s> epoch_t;
+
+    typedef multi_index<name("buckets"), bucket_s,
+        indexed_by<name("ownerrange"), const_mem_fun<bucket_s, uint128_t, &bucket_s::by_owner_range>>>
+        bucket_t;
+
+    typedef multi_index<name("counts"), count_s,
+        indexed_by<name("usertemplate"), const_mem_fun<count_s, uint128_t, &count_s::by_user_template>>,
+        indexed_by<name("templateuser"), const_mem_fun<count_s, uint128_t, &count_s::by_template_user>>>
+        count_t;
+
+    typedef multi_index<name("rerates"), rerate_s> rerate_t;
+
+    typedef multi_index<name("boosts"), boost_s,
+        indexed_by<name("userset"), const_mem_fun<boost_s, uint128_t, &boost_s::by_user_set>>,
+        indexed_by<name("setuser"), const_mem_fun<boost_s, uint128_t, &boost_s::by_set_user>>>
+        boost_t;
+
+    typedef multi_index<name("slots"), slot_s,
+        indexed_by<name("template"), const_mem_fun<slot_s, uint64_t, &slot_s::by_template>>>
+        slot_t;
+
     typedef singleton<name("config"), config> config_t;
+    typedef singleton<name("pool"), pool_s> pool_t;
+    typedef singleton<name("stats"), stats_s> stats_t;
+    typedef singleton<name("payout"), payout_s> payout_t;
 
     // Utilities
 
     // check if the contract is initialized
-    config check_config()
+    config check_config();
+
+    // get the config, even while the contract is frozen
+    // a FIXED_CONFIG build has nothing to initialize, it runs with the default row until an admin action saves one
+    config read_config();
+
+    // the token and the periods, from the config row or baked in by FIXED_CONFIG
+#if FIXED_CONFIG
+    static constexpr name token_contract(const config&) { return name(EZSTAKE_STRING(FIXED_TOKEN_CONTRACT)); }
+    static constexpr symbol token_symbol(const config&) { return symbol(symbol_code(EZSTAKE_STRING(FIXED_TOKEN_SYMBOL)), FIXED_TOKEN_PRECISION); }
+    static constexpr uint32_t min_claim_period(const config&) { return FIXED_MIN_CLAIM_PERIOD; }
+    static constexpr uint32_t unstake_period(const config&) { return FIXED_UNSTAKE_PERIOD; }
+#else
+    static name token_contract(const config& conf) { return conf.token_contract; }
+    static symbol token_symbol(const config& conf) { return conf.token_symbol; }
+    static uint32_t min_claim_period(const config& conf) { return conf.min_claim_period; }
+    static uint32_t unstake_period(const config& conf) { return conf.unstake_period; }
+#endif
+
+    // fail with the error code and the id it's about
+    // `message` only formats the message of the VERBOSE_ERRORS builds, the others never call it
+    template <typename Message>
+    static void fail(const error_code_t& code, const uint64_t& id, Message&& message);
+
+    // check that the user isn't being reset in batches, its stakes would outlive the reset
+    void check_not_resetting(const name& user);
+
+    // get the template id of a staked asset
+    // assets staked before the template id was cached fall back to the atomicassets table
+    int32_t get_template_id(const asset_s& row);
+
+    // get the reward generated by one asset of the template from the beginning up to `t`, in rate amount * seconds
+    // the templates without a history have had their current rate since the beginning
+    uint128_t get_integral(const template_s& tmpl, const time_point_sec& t);
+
+    // get the reward generated by one asset of the template between `from` and `to`
+    // follows the template's rate history, so a rate change only applies from when it was made
+    int64_t get_reward(const template_s& tmpl, const time_point_sec& from, const time_point_sec& to);
+
+    // append a rate change to the template's history
+    // a template without a history gets a first epoch with its old rate since the beginning
+    void add_epoch(const int32_t& template_id, const asset& old_rate, const asset& new_rate);
+
+    // check if a template has a rate history
+    bool has_epochs(const int32_t& template_id);
+
+    // insert a template or change its rate, recording the change in its history
+    // the users still staking it at another rate are queued for re-rating
+    void set_template(template_t& template_tbl, const int32_t& template_id, const name& collection, const asset& hourly_rate, const bool& from_rule);
+
+    // queue a rate change of a staked template, the users are moved to the new rate on their next action or by the rerate action
+    void queue_rerate(const int32_t& template_id);
+
+    // check if a user's count is at the current rates of its template
+    static bool is_rerated(const count_s& count, const template_s& tmpl);
+
+    // erase a template, its staked assets don't generate anything until it's added back
+    // the users staking it are queued for re-rating to a zero rate, like on a rate change
+    void remove_template(template_t& template_tbl, const template_t::const_iterator& template_row);
+
+    // check if any user has counted assets of a template
+    bool has_counts(const int32_t& template_id);
+
+    // get the rates the users of a pending re-rate are moved to, a removed template has none left
+    template_s get_rerate_target(template_t& template_tbl, const int32_t& template_id, const symbol& token);
+
+    // get the rate of the most specific rule of a schema, the schema's own rule or the collection's
+    std::optional<asset> find_rule_rate(const name& collection, const name& schema);
+
+    // check if the user has a checkpoint set in the current reward mode, there are none in per-asset mode
+    static bool has_checkpoint(const config& conf, const user_s& user_row);
+
+    // get the rewards a user accrued before the last mode switch, left on their stale checkpoint
+    // nothing is staked when a per-user mode is left, so they don't grow past the checkpoint
+    static asset get_carried(const config& conf, const user_s& user_row);
+
+    // get the rewards accrued by a user up to `now` (accrual mode)
+    // users without a checkpoint were staking in per-asset mode, their pending rewards are summed from their assets
+    asset get_accrued(const config& conf, const user_s& user_row, const time_point_sec& now);
+
+    // remove the unstaked rate and counts from the user and send the unstaked assets back
+    // `forfeited` is the unclaimed rewards of the unstaked assets (per-asset mode)
+    void send_unstaked(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr, const asset& removed_rate, const vector<pair<int32_t, int64_t>>& tally, const vector<uint64_t>& asset_ids, const int64_t& forfeited);
+
+    // pay out everything the user accrued up to now (per-user modes), `pool` must be settled up to now (pool mode)
+    // returns the amount to send to the user
+    asset settle_user(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr, const pool_s& pool, const time_point_sec& now);
+
+    // send one of the log actions, with the new total power
+    void send_log(const name& log_action, const name& user, const vector<uint64_t>& asset_ids, const asset& amount, const asset& hourly_rate);
+
+    // add `delta` to the user's hourly_rate and `staked_delta` to the staked assets count
+    // in accrual and pool modes the checkpoint is moved first, so the old rate applies up to now
+    void change_rate(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr, const asset& delta, const int64_t& staked_delta = 0);
+
+    // add `delta` assets of a template to a tally of staked/unstaked assets
+    static void tally_template(vector<pair<int32_t, int64_t>>& tally, const int32_t& template_id, const int64_t& delta);
+
+    // sort the asset ids of a batch, so they're walked in the table order, and reject the duplicates up front
+    static vector<uint64_t> sort_batch(const vector<uint64_t>& asset_ids);
+
+    // a template looked up once for a whole batch of assets
+    struct cached_template {
+        int32_t template_id;
+        bool is_stakeable;
+        template_s row;
+        // the reward integral of the template up to the batch time, computed by the first reward
+        std::optional<uint128_t> integral;
+    };
+
+    // get the template of an asset through the batch cache, nullptr if it isn't stakeable
+    // a batch only spans a few templates, so the cache is a flat vector; the pointer is valid until the next lookup
+    cached_template* find_cached(vector<cached_template>& cache, template_t& template_tbl, const int32_t& template_id);
+
+    // give a template without a row of its own the rate of the most specific rule matching the asset
+    // called by the first stake of the template, returns nullptr if no rule matches
+    cached_template* cache_rule_template(vector<cached_template>& cache, template_t& template_tbl, const atomicassets::assets_s& aa_asset);
+
+    // get_reward for a cached template, `to` must be the batch time
+    int64_t get_cached_reward(cached_template& cached, const time_point_sec& from, const time_point_sec& to);
+
+    // apply a tally of staked/unstaked assets to the user's per-template counts
+    // new counts are recorded at the template's current rate, the counts that reach zero are erased
+    void update_counts(const name& user, const vector<pair<int32_t, int64_t>>& tally);
+
+    // apply a tally of staked/unstaked assets to the templates' staked counters
+    void update_template_stats(const vector<pair<int32_t, int64_t>>& tally);
+
+    // get the global stats with the liability moved to now, without saving them
+    stats_s peek_stats(const config& conf);
+
+    // move the global stats' liability to now, then apply `updater` to them
+    template <typename Lambda>
+    void update_stats(const config& conf, Lambda&& updater);
+
+    // add `delta` to a counter, stopping at 0
+    // the assets and users that predate the stats were never counted, so a counter can't go below 0
+    static void add_saturated(uint64_t& value, const int64_t& delta);
+
+    // move the user to its new rate in the leaderboard (leaderboard builds only, the users' rate index is the leaderboard otherwise)
+    // a full leaderboard evicts its lowest user for a higher one, and drops a user that falls below all the others
+    // as the users outside of it may rank higher by now, the spot goes to the next user whose rate changes
+    void update_leaderboard(stats_s& stats, const name& user, const uint64_t& hourly_rate);
+
+    // take rewards that were claimed or forfeited out of the liability
+    static void release_liability(stats_s& stats, const int64_t& amount);
+
+    // get the reward of one staked asset between `from` and `to`, 0 if its template was removed
+    int64_t get_asset_reward(const int32_t& template_id, const time_point_sec& from, const time_point_sec& to);
+
+    // erase all the per-template counts of a user
+    // the counts a re-added template didn't re-rate yet are added to its staked counter, as the caller takes the assets out of it
+    void erase_counts(const name& user);
+
+    // move the user's hourly_rate to the new rate of the templates pending a re-rate
+    // only reads the rerates table when no template rate changed
+    void rerate_user(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr);
+
+    // move the user's set boosts to their counts, after the templates of the tally were staked, unstaked or re-rated (per-user modes)
+    // only the sets of these templates are recomputed, each from the user's counts of its templates
+    void update_boosts(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr, const vector<pair<int32_t, int64_t>>& tally);
+
+    // erase all the set boosts of a user, without changing their rate
+    void erase_boosts(const name& user);
+
+    // get the pool with its accumulator moved to now, without saving it (pool mode)
+    // the tokens emitted while nothing is staked aren't distributed
+    pool_s peek_pool(const config& conf);
+
+    // move the pool's accumulator to now, then add `power_delta` to its total power (pool mode)
+    pool_s update_pool(const config& conf, const int64_t& power_delta);
+
+    // move the user's accrual checkpoint to `now` (accrual mode)
+    // must be applied before the user's hourly_rate changes
+    static void set_checkpoint(const config& conf, user_s& row, const asset& accrued, const time_point_sec& now);
+
+    // clear the rewards a user accrued before the switch to per-asset mode and return them, to be paid along a claim
+    asset take_carried(user_t& user_tbl, const user_t::const_iterator& user_itr);
+
+    // add `times` times the `delta` rates to a list of token amounts, one per token
+    // the tokens that reach 0 are removed, the lists only hold a few tokens so they're kept as flat vectors
+    static void add_rates(vector<extended_asset>& rates, const vector<extended_asset>& delta, const int64_t& times);
+
+    // move the extra tokens accrual checkpoint of a user to `now`
+    static void accrue_extras(reward_s& row, const time_point_sec& now);
+
+    // add `delta` to the user's extra rates, the rewards accrued with the old rates are kept
+    void change_extra_rates(const name& user, const vector<extended_asset>& delta);
+
+    // save the extra token rewards of a user, the row is erased once it holds nothing
+    void save_extras(reward_t& reward_tbl, const reward_t::const_iterator& reward_itr, const reward_s& reward);
+
+    // get the extra token rewards a user accrued up to `now`
+    vector<extended_asset> get_extras_accrued(const name& user, const time_point_sec& now);
+
+    // pay out the extra token rewards the user accrued up to now, with one transfer per token
+    // they keep accruing while the user is in cooldown, returns whether anything was paid
+    bool pay_extras(const config& conf, const name& user, const time_point_sec& now);
+
+    // stop the user's extra token rewards, the rewards already accrued are kept
+    // used to rebuild the extra rates from the counts
+    void clear_extra_rates(const name& user);
+
+    // erase the extra token rewards of a user, the unclaimed ones are lost
+    void erase_extras(const name& user);
+
+    // check if any asset is staked, in either storage
+    bool has_staked_assets();
+
+    // take the RAM of `count` new assets rows out of the user's deposit (user RAM mode)
+    void use_deposit(const name& user, const uint64_t& count);
+
+    // get the slot of a template, a new slot is assigned to the templates that don't have one yet
+    uint16_t get_slot(const int32_t& template_id);
+
+    // get the template id of a slot
+    int32_t get_slot_template(const uint16_t& slot);
+
+    // find the bucket of the user whose range holds the asset_id
+    // returns end() if the asset_id is below the range of the user's first bucket (or if the user has none)
+    template <typename Index>
+    auto find_bucket(const Index& bucket_idx, const name& user, const uint64_t& asset_id);
+
+    // save the entries (sorted by asset_id) of a bucket's range
+    // the entries that don't fit are split evenly into new buckets, an emptied bucket is erased
+    void save_bucket(bucket_t& bucket_tbl, const bucket_s* bucket, const name& user, const uint64_t& lo_id, const vector<bucket_entry>& entries);
+
+    // add the entries to the user's buckets
+    // each bucket is written once no matter how many entries it receives
+    void bucket_insert(const name& user, vector<bucket_entry> entries);
+
+    // remove the assets from the user's buckets
+    // returns the removed entries, fails if an asset isn't staked by the user
+    vector<bucket_entry> bucket_remove(const name& user, vector<uint64_t> asset_ids);
+
+    // read at most max_rows of the user's staked assets starting from from_id, in either storage
+    // the visitor gets the asset id, its template id and its last claim (or stake) time
+    // returns the asset id to resume from, or 0 if there's no assets left
+    template <typename Visitor>
+    uint64_t walk_assets(const config& conf, const name& user, const uint64_t& from_id, const uint32_t& max_rows, Visitor&& visit);
+
+    // call `walk` with an index of the assets table and the iterator to the user's first row from from_id
+    // both indexes sort a user's rows by asset id, but the rows stored before the ownerasset index existed
+    // are missing from it, so the owner index is walked instead until backfill is done
+    template <typename Walk>
+    static void with_owner_index(const config& conf, asset_t& asset_tbl, const name& user, const uint64_t& from_id, Walk&& walk);
+
+    // walk at most max_rows of the user's bucket entries starting from from_id
+    // the entries for which `remove` returns true are removed, only the buckets that changed are written
+    // returns the asset id to resume from, or 0 if there's no entries left
+    template <typename Visitor>
+    uint64_t bucket_walk(const name& user, const uint64_t& from_id, const uint32_t& max_rows, Visitor&& remove);
+
+    // Reward math, without table access so the indexer can share it (see indexer/deltas.hpp)
+
+    // get the reward integral of an epoch up to `t`
+    static uint128_t epoch_integral(const epoch_s& epoch, const time_point_sec& t)
+    {
+        return epoch.integral + uint128_t(epoch.hourly_rate.amount) * (t.sec_since_epoch() - epoch.start.sec_since_epoch());
+    }
+
+    // get the rewards accrued by a user with a checkpoint up to `now` (accrual mode)
+    static asset get_checkpoint_accrued(const user_s& user_row, const time_point_sec& now)
+    {
+        asset accrued = user_row.accrued.value();
+        accrued.amount += (user_row.hourly_rate.amount * (now.sec_since_epoch() - user_row.last_update->sec_since_epoch())) / 3600;
+
+        return accrued;
+    }
+
+    // compute a * b / c without overflowing the intermediate product
+    static uint128_t muldiv(const uint128_t& a, const uint128_t& b, const uint128_t& c)
+    {
+        const uint128_t quotient = a / c;
+        const uint128_t remainder = a % c;
+
+        check(b == 0 || quotient <= ~uint128_t(0) / b, "reward overflow");
+
+        return quotient * b + remainder * b / c;
+    }
+
+    // move the pool's accumulator to `now` (pool mode)
+    static pool_s advance_pool(const config& conf, pool_s pool, const time_point_sec& now)
+    {
+        if (pool.total_power > 0 && now > pool.last_update) {
+            const uint128_t emitted = uint128_t(conf.hourly_emission.value_or().amount) * (now.sec_since_epoch() - pool.last_update.sec_since_epoch());
+
+            pool.acc_reward_per_power += muldiv(emitted, REWARD_PRECISION, uint128_t(pool.total_power) * 3600);
+        }
+
+        pool.last_update = now;
+
+        return pool;
+    }
+
+    // get the rewards accrued by a user up to the pool's last update (pool mode)
+    static asset get_pool_accrued(const user_s& user_row, const pool_s& pool)
     {
-        // get config table
-        config_t conf_tbl(get_self(), get_self().value);
+        asset accrued = user_row.accrued.value_or(asset(0, user_row.hourly_rate.symbol));
 
-        // check if a config exists
-        check(conf_tbl.exists(), "smart contract is not initialized yet");
+        const uint128_t pending = muldiv(user_row.hourly_rate.amount, pool.acc_reward_per_power, REWARD_PRECISION) - user_row.reward_debt.value_or(0);
 
-        // get  current config
-        const auto& conf = conf_tbl.get();
+        check(pending <= uint128_t(asset::max_amount), "reward overflow");
 
-        // check if contract isn't frozen
-        check(!conf.is_frozen, "smart contract is currently frozen");
+        accrued.amount += int64_t(pending);
 
-        return conf;
+        return accrued;
     }
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <ezstake.hpp>
 
+#include "ezstake_impl.hpp"
+
 ACTION ezstake::setfrozen(const bool& is_frozen)
 {
     // check contract auth
@@ -14,12 +16,21 @@ ACTION ezstake::setfrozen(const bool& is_frozen)
     check(!(conf.is_frozen && is_frozen), "contract is already frozen");
     check(!(!conf.is_frozen && !is_frozen), "contract is already non-frozen");
 
+    // the bucket storage expects every asset to be packed
+    if (!is_frozen && conf.storage_mode.value_or(ROWS) == BUCKETS) {
+        // get asset table instance
+        asset_t asset_tbl(get_self(), get_self().value);
+
+        check(asset_tbl.begin() == asset_tbl.end(), "staked assets must be packed before unfreezing");
+    }
+
     conf.is_frozen = is_frozen;
 
     // save the new config
     conf_tbl.set(conf, get_self());
 }
 
+#if !FIXED_CONFIG
 ACTION ezstake::setconfig(const uint32_t& min_claim_period, const uint32_t& unstake_period)
 {
     // check contract auth
@@ -53,85 +64,1370 @@ ACTION ezstake::settoken(const name& contract, const symbol& symbol)
     // get config table instance
     config_t conf_tbl(get_self(), get_self().value);
 
-    // get/create current config
-    auto conf = conf_tbl.get_or_default(config {});
+    // get/create current config
+    auto conf = conf_tbl.get_or_default(config {});
+
+    conf.token_contract = contract;
+    conf.token_symbol = symbol;
+
+    // save the new config
+    conf_tbl.set(conf, get_self());
+}
+#endif
+
+ACTION ezstake::setmode(const uint8_t& reward_mode)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the mode is valid
+    check(reward_mode <= POOL, "invalid reward mode");
+
+    // get config table instance
+    config_t conf_tbl(get_self(), get_self().value);
+
+    // get/create current config
+    auto conf = conf_tbl.get_or_default(config {});
+
+    const uint8_t current_mode = conf.reward_mode.value_or(PER_ASSET);
+
+    check(current_mode != reward_mode, "reward mode is already set");
+
+    // the bucket entries don't keep a claim time per asset
+    check(conf.storage_mode.value_or(ROWS) != BUCKETS || reward_mode != PER_ASSET, "bucket storage requires a per-user reward mode");
+
+    // the per-asset users are converted to the accrual mode on their next action
+    // any other switch would lose track of the pending rewards, so it's only allowed when nothing is staked
+    if (current_mode != PER_ASSET || reward_mode != ACCRUAL) {
+        check(!has_staked_assets(), "reward mode can only be changed while no assets are staked");
+    }
+
+    // start a new pool, nothing is staked at this point
+    if (reward_mode == POOL) {
+        // get pool table instance
+        pool_t pool_tbl(get_self(), get_self().value);
+
+        pool_s pool = {};
+        pool.last_update = current_time_point();
+
+        pool_tbl.set(pool, get_self());
+    }
+
+    // the checkpoints set before the switch are stale from now on
+    // the extensions before mode_switches must be set for it to be serialized
+    conf.reward_mode = reward_mode;
+    conf.storage_mode = conf.storage_mode.value_or(ROWS);
+    conf.hourly_emission = conf.hourly_emission.value_or(asset(0, token_symbol(conf)));
+    conf.min_payout = conf.min_payout.value_or(asset(0, token_symbol(conf)));
+    conf.ram_mode = conf.ram_mode.value_or(CONTRACT_RAM);
+    conf.mode_switches = conf.mode_switches.value_or(0) + 1;
+
+    // save the new config
+    conf_tbl.set(conf, get_self());
+}
+
+ACTION ezstake::setemission(const asset& hourly_emission)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // get config table instance
+    config_t conf_tbl(get_self(), get_self().value);
+
+    // get/create current config
+    auto conf = conf_tbl.get_or_default(config {});
+
+    // check if the emission is valid
+    check(hourly_emission.amount >= 0, "hourly_emission must not be negative");
+    check(token_symbol(conf) == hourly_emission.symbol, "symbol mismatch");
+
+    // distribute the tokens emitted at the old rate
+    if (conf.reward_mode.value_or(PER_ASSET) == POOL) {
+        update_pool(conf, 0);
+        update_stats(conf, [](stats_s&) {});
+    }
+
+    // the extensions before hourly_emission must be set for it to be serialized
+    conf.reward_mode = conf.reward_mode.value_or(PER_ASSET);
+    conf.storage_mode = conf.storage_mode.value_or(ROWS);
+    conf.hourly_emission = hourly_emission;
+
+    // save the new config
+    conf_tbl.set(conf, get_self());
+}
+
+ACTION ezstake::setpayout(const asset& min_payout)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // get config table instance
+    config_t conf_tbl(get_self(), get_self().value);
+
+    // get/create current config
+    auto conf = conf_tbl.get_or_default(config {});
+
+    // check if the minimum payout is valid
+    check(min_payout.amount >= 0, "min_payout must not be negative");
+    check(token_symbol(conf) == min_payout.symbol, "symbol mismatch");
+
+    // the extensions before min_payout must be set for it to be serialized
+    conf.reward_mode = conf.reward_mode.value_or(PER_ASSET);
+    conf.storage_mode = conf.storage_mode.value_or(ROWS);
+    conf.hourly_emission = conf.hourly_emission.value_or(asset(0, token_symbol(conf)));
+    conf.min_payout = min_payout;
+
+    // save the new config
+    conf_tbl.set(conf, get_self());
+}
+
+ACTION ezstake::setextras(const int32_t& template_id, const vector<extended_asset>& extra_rates)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    check(extra_rates.size() <= MAX_EXTRA_TOKENS, "too many extra tokens");
+
+    for (size_t i = 0; i < extra_rates.size(); i++) {
+        const extended_asset& rate = extra_rates[i];
+
+        // check if the extra rate is valid
+        check(rate.quantity.is_valid(), "invalid extra rate");
+        check(rate.quantity.amount > 0, "extra rates must be positive");
+        check(rate.get_extended_symbol() != extended_symbol(token_symbol(config), token_contract(config)), "the reward token can't be an extra token");
+
+        for (size_t j = 0; j < i; j++) {
+            check(extra_rates[j].get_extended_symbol() != rate.get_extended_symbol(), "extra token listed more than once");
+        }
+    }
+
+    // get templates table instance
+    template_t template_tbl(get_self(), get_self().value);
+    // get counts table instance
+    count_t count_tbl(get_self(), get_self().value);
+
+    const auto& template_itr = template_tbl.find(uint64_t(template_id));
+
+    check(template_itr != template_tbl.end(), "template not found");
+
+    // get the secondary index
+    auto count_idx = count_tbl.get_index<name("templateuser")>();
+
+    const auto& count_itr = count_idx.lower_bound(template_user_key(template_id, name()));
+    const bool is_staked = count_itr != count_idx.end() && count_itr->template_id == template_id;
+
+    // the users staking the template are moved to the new rates like on a rate change
+    if (is_staked && template_itr->extra_rates.value_or() != extra_rates) {
+        queue_rerate(template_id);
+    }
+
+    template_tbl.modify(template_itr, same_payer, [&](template_s& row) {
+        // the extensions before extra_rates must be set for it to be serialized
+        row.staked = row.staked.value_or(0);
+        row.from_rule = row.from_rule.value_or(false);
+        row.extra_rates = extra_rates;
+    });
+}
+
+ACTION ezstake::setstorage(const uint8_t& storage_mode)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the mode is valid
+    check(storage_mode <= BUCKETS, "invalid storage mode");
+
+    // get config table instance
+    config_t conf_tbl(get_self(), get_self().value);
+
+    // get/create current config
+    auto conf = conf_tbl.get_or_default(config {});
+
+    check(conf.storage_mode.value_or(ROWS) != storage_mode, "storage mode is already set");
+
+    if (storage_mode == BUCKETS) {
+        check(conf.reward_mode.value_or(PER_ASSET) != PER_ASSET, "bucket storage requires a per-user reward mode");
+        check(conf.ram_mode.value_or(CONTRACT_RAM) == CONTRACT_RAM, "bucket storage requires the contract RAM mode");
+
+        // get asset table instance
+        asset_t asset_tbl(get_self(), get_self().value);
+
+        // the actions only look into the buckets, so the existing rows must be packed before the users can act again
+        check(asset_tbl.begin() == asset_tbl.end() || conf.is_frozen, "contract must be frozen to pack the staked assets");
+    } else {
+        check(!has_staked_assets(), "storage mode can only be changed while no assets are staked");
+    }
+
+    // the reward_mode extension is always set at this point, so the storage_mode can be serialized after it
+    conf.storage_mode = storage_mode;
+
+    // save the new config
+    conf_tbl.set(conf, get_self());
+}
+
+ACTION ezstake::setrammode(const uint8_t& ram_mode)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the mode is valid
+    check(ram_mode <= USER_RAM, "invalid RAM mode");
+
+    // get config table instance
+    config_t conf_tbl(get_self(), get_self().value);
+
+    // get/create current config
+    auto conf = conf_tbl.get_or_default(config {});
+
+    check(conf.ram_mode.value_or(CONTRACT_RAM) != ram_mode, "RAM mode is already set");
+
+    // the buckets are rewritten as the assets come and go, they can't be billed to a user from a notification
+    check(ram_mode != USER_RAM || conf.storage_mode.value_or(ROWS) == ROWS, "user RAM mode requires the rows storage");
+
+    // the extensions before ram_mode must be set for it to be serialized
+    conf.reward_mode = conf.reward_mode.value_or(PER_ASSET);
+    conf.storage_mode = conf.storage_mode.value_or(ROWS);
+    conf.hourly_emission = conf.hourly_emission.value_or(asset(0, token_symbol(conf)));
+    conf.min_payout = conf.min_payout.value_or(asset(0, token_symbol(conf)));
+    conf.ram_mode = ram_mode;
+
+    // save the new config
+    conf_tbl.set(conf, get_self());
+}
+
+ACTION ezstake::addtemplates(const std::vector<template_item>& templates)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get templates table instance
+    template_t template_tbl(get_self(), get_self().value);
+
+    for (const template_item& t : templates) {
+        // check if the hourly rate is valid
+        check(t.hourly_rate.amount > 0, "hourly_rate must be positive");
+        check(token_symbol(config) == t.hourly_rate.symbol, "symbol mismatch");
+
+        // check if the template exists in atomicassets and it's valid
+        const auto& aa_template_tbl = atomicassets::get_templates(t.collection);
+
+        const auto& aa_template_itr = aa_template_tbl.find(uint64_t(t.template_id));
+
+        if (aa_template_itr == aa_template_tbl.end()) {
+            fail(TEMPLATE_NOT_FOUND, t.template_id, [&]() { return string("template (" + to_string(t.template_id) + ") not found in collection " + t.collection.to_string()); });
+        }
+
+        // insert the new template or update it if it already exists, its own rate takes over the rules
+        set_template(template_tbl, t.template_id, t.collection, t.hourly_rate, false);
+    }
+}
+
+ACTION ezstake::rmtemplates(const std::vector<template_item>& templates)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    check_config();
+
+    // get templates table instance
+    template_t template_tbl(get_self(), get_self().value);
+
+    for (const template_item& t : templates) {
+        const auto& template_row = template_tbl.find(uint64_t(t.template_id));
+
+        // erase the template if it already exists
+        if (template_row != template_tbl.end()) {
+            remove_template(template_tbl, template_row);
+        }
+
+        // exclude the template from the rules, its next stake would add it back otherwise
+        const auto& aa_template_tbl = atomicassets::get_templates(t.collection);
+        const auto& aa_template_itr = aa_template_tbl.find(uint64_t(t.template_id));
+
+        if (aa_template_itr == aa_template_tbl.end() || !find_rule_rate(t.collection, aa_template_itr->schema_name).has_value()) {
+            continue;
+        }
+
+        // get exclusions table instance
+        exclusion_t exclusion_tbl(get_self(), t.collection.value);
+
+        if (exclusion_tbl.find(uint64_t(t.template_id)) == exclusion_tbl.end()) {
+            exclusion_tbl.emplace(get_self(), [&](exclusion_s& row) { row.template_id = t.template_id; });
+        }
+    }
+}
+
+ACTION ezstake::stageimport(const std::vector<template_item>& templates)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get imports table instances
+    import_t import_tbl(get_self(), get_self().value);
+    import_t invalid_tbl(get_self(), name("invalid").value);
+
+    for (const template_item& t : templates) {
+        // check if the hourly rate is valid
+        check(t.hourly_rate.amount > 0, "hourly_rate must be positive");
+        check(token_symbol(config) == t.hourly_rate.symbol, "symbol mismatch");
+
+        // clear the previous rejection of the template
+        const auto& invalid_itr = invalid_tbl.find(uint64_t(t.template_id));
+
+        if (invalid_itr != invalid_tbl.end()) {
+            invalid_tbl.erase(invalid_itr);
+        }
+
+        const auto& import_itr = import_tbl.find(uint64_t(t.template_id));
+
+        // stage the template or replace its staged rate
+        if (import_itr == import_tbl.end()) {
+            import_tbl.emplace(get_self(), [&](import_s& row) {
+                row.template_id = t.template_id;
+                row.collection = t.collection;
+                row.hourly_rate = t.hourly_rate;
+            });
+        } else {
+            import_tbl.modify(import_itr, get_self(), [&](import_s& row) {
+                row.collection = t.collection;
+                row.hourly_rate = t.hourly_rate;
+            });
+        }
+    }
+}
+
+ACTION ezstake::commitimport(const uint32_t& limit)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the limit is valid
+    check(limit > 0, "limit must be positive");
+
+    // check if the contract isn't frozen
+    check_config();
+
+    // get imports table instances
+    import_t import_tbl(get_self(), get_self().value);
+    import_t invalid_tbl(get_self(), name("invalid").value);
+    // get templates table instance
+    template_t template_tbl(get_self(), get_self().value);
+    // get rerates table instance
+    rerate_t rerate_tbl(get_self(), get_self().value);
+
+    auto import_itr = import_tbl.begin();
+
+    // the committed templates leave the staging table, so a failed call resumes from where it stopped
+    for (uint32_t i = 0; i < limit && import_itr != import_tbl.end(); i++) {
+        const import_s staged = *import_itr;
+        uint16_t error = 0;
+
+        // check if the template exists in atomicassets and it's valid
+        const auto& aa_template_tbl = atomicassets::get_templates(staged.collection);
+        const auto& template_row = template_tbl.find(uint64_t(staged.template_id));
+
+        if (aa_template_tbl.find(uint64_t(staged.template_id)) == aa_template_tbl.end()) {
+            error = TEMPLATE_NOT_FOUND;
+        } else if ((template_row == template_tbl.end() || template_row->hourly_rate != staged.hourly_rate) && rerate_tbl.find(uint64_t(staged.template_id)) != rerate_tbl.end()) {
+            error = TEMPLATE_RERATING;
+        }
+
+        if (error == 0) {
+            set_template(template_tbl, staged.template_id, staged.collection, staged.hourly_rate, false);
+        } else {
+            // keep the rejected template aside instead of failing the whole batch
+            invalid_tbl.emplace(get_self(), [&](import_s& row) {
+                row = staged;
+                row.error = error;
+            });
+        }
+
+        import_itr = import_tbl.erase(import_itr);
+    }
+
+    // print the template to be committed next
+    if (import_itr != import_tbl.end()) {
+        print("next: ", import_itr->template_id);
+    } else {
+        print("done");
+    }
+}
+
+ACTION ezstake::setrule(const name& collection, const name& schema, const asset& hourly_rate)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // check if the hourly rate is valid
+    check(hourly_rate.amount > 0, "hourly_rate must be positive");
+    check(token_symbol(config) == hourly_rate.symbol, "symbol mismatch");
+
+    // check if the collection exists in atomicassets
+    if (atomicassets::collections.find(collection.value) == atomicassets::collections.end()) {
+        fail(COLLECTION_NOT_FOUND, 0, [&]() { return string("collection " + collection.to_string() + " not found"); });
+    }
+
+    // check if the schema exists in the collection
+    if (schema != name()) {
+        const auto& aa_schema_tbl = atomicassets::get_schemas(collection);
+
+        if (aa_schema_tbl.find(schema.value) == aa_schema_tbl.end()) {
+            fail(SCHEMA_NOT_FOUND, 0, [&]() { return string("schema " + schema.to_string() + " not found in collection " + collection.to_string()); });
+        }
+    }
+
+    // get rules table instance
+    rule_t rule_tbl(get_self(), collection.value);
+
+    const auto& rule_itr = rule_tbl.find(schema.value);
+
+    // insert the new rule or update it if it already exists
+    if (rule_itr == rule_tbl.end()) {
+        rule_tbl.emplace(get_self(), [&](rule_s& row) {
+            row.schema = schema;
+            row.hourly_rate = hourly_rate;
+        });
+    } else {
+        rule_tbl.modify(rule_itr, get_self(), [&](rule_s& row) { row.hourly_rate = hourly_rate; });
+    }
+}
+
+ACTION ezstake::rmrule(const name& collection, const name& schema)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    check_config();
+
+    // get rules table instance
+    rule_t rule_tbl(get_self(), collection.value);
+
+    const auto& rule_itr = rule_tbl.find(schema.value);
+
+    // check if the rule exists
+    if (rule_itr == rule_tbl.end()) {
+        fail(RULE_NOT_FOUND, 0, [&]() { return string("no rule for " + collection.to_string() + (schema != name() ? "/" + schema.to_string() : "")); });
+    }
+
+    rule_tbl.erase(rule_itr);
+}
+
+ACTION ezstake::addset(const uint64_t& set_id, const vector<int32_t>& template_ids, const uint16_t& boost)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // the boosts are added to the users' rate
+    check(config.reward_mode.value_or(PER_ASSET) != PER_ASSET, "set boosts require a per-user reward mode");
+
+    // check if the set is valid
+    check(template_ids.size() >= 2 && template_ids.size() <= MAX_SET_TEMPLATES, "a set must have 2 to 16 templates");
+    check(boost > 0, "boost must be positive");
+
+    for (size_t i = 0; i < template_ids.size(); i++) {
+        for (size_t j = 0; j < i; j++) {
+            check(template_ids[j] != template_ids[i], "template listed more than once");
+        }
+    }
+
+    // get sets table instance
+    set_t set_tbl(get_self(), get_self().value);
+
+    check(set_tbl.find(set_id) == set_tbl.end(), "set already exists");
+
+    set_tbl.emplace(get_self(), [&](set_s& row) {
+        row.set_id = set_id;
+        row.template_ids = template_ids;
+        row.boost = boost;
+    });
+
+    // link the templates to the set, so a stake only recomputes the sets of its templates
+    for (const int32_t& template_id : template_ids) {
+        // get set links table instance
+        setlink_t setlink_tbl(get_self(), uint64_t(template_id));
+
+        setlink_tbl.emplace(get_self(), [&](setlink_s& row) { row.set_id = set_id; });
+    }
+}
+
+ACTION ezstake::rmset(const uint64_t& set_id, const uint32_t& max_rows)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the max rows is valid
+    check(max_rows > 0, "max_rows must be positive");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get sets table instance
+    set_t set_tbl(get_self(), get_self().value);
+
+    const auto& set_itr = set_tbl.require_find(set_id, "set does not exist");
+
+    // unlink the templates, the stakes/unstakes stop recomputing the set
+    for (const int32_t& template_id : set_itr->template_ids) {
+        // get set links table instance
+        setlink_t setlink_tbl(get_self(), uint64_t(template_id));
+
+        const auto& link_itr = setlink_tbl.find(set_id);
+
+        if (link_itr != setlink_tbl.end()) {
+            setlink_tbl.erase(link_itr);
+        }
+    }
+
+    // get users table instance
+    user_t user_tbl(get_self(), get_self().value);
+    // get boosts table instance
+    boost_t boost_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto boost_idx = boost_tbl.get_index<name("setuser")>();
+    auto boost_itr = boost_idx.lower_bound(set_user_key(set_id, name()));
+
+    // take the boost out of the users' rate
+    for (uint32_t i = 0; i < max_rows && boost_itr != boost_idx.end() && boost_itr->set_id == set_id; i++) {
+        const auto& user_itr = user_tbl.find(boost_itr->user.value);
+        const asset bonus_rate = boost_itr->bonus_rate;
+
+        boost_itr = boost_idx.erase(boost_itr);
+
+        if (user_itr != user_tbl.end() && bonus_rate.amount != 0) {
+            change_rate(config, user_tbl, user_itr, -bonus_rate);
+        }
+    }
+
+    // print the user to resume from in the next call
+    if (boost_itr != boost_idx.end() && boost_itr->set_id == set_id) {
+        print("next: ", boost_itr->user);
+    } else {
+        // every user lost the boost
+        set_tbl.erase(set_itr);
+
+        print("done");
+    }
+}
+
+ACTION ezstake::syncrules(const name& collection, const int32_t& from_template, const uint32_t& max_rows)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the max rows is valid
+    check(max_rows > 0, "max_rows must be positive");
+
+    // check if the contract isn't frozen
+    check_config();
+
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+
+    // the templates of the collection, with their schema
+    const auto& aa_template_tbl = atomicassets::get_templates(collection);
+    auto aa_template_itr = aa_template_tbl.lower_bound(uint64_t(from_template));
+
+    for (uint32_t i = 0; i < max_rows && aa_template_itr != aa_template_tbl.end(); i++, aa_template_itr++) {
+        const auto& template_itr = template_tbl.find(uint64_t(aa_template_itr->template_id));
+
+        // skip the templates that were never staked and the ones with a rate of their own
+        if (template_itr == template_tbl.end() || !template_itr->from_rule.value_or(false)) {
+            continue;
+        }
+
+        const std::optional<asset> hourly_rate = find_rule_rate(collection, aa_template_itr->schema_name);
+
+        if (!hourly_rate.has_value()) {
+            // the rule was removed, the template is removed like with rmtemplates
+            remove_template(template_tbl, template_itr);
+        } else if (hourly_rate.value() != template_itr->hourly_rate) {
+            set_template(template_tbl, aa_template_itr->template_id, collection, hourly_rate.value(), true);
+        }
+    }
+
+    // print the cursor to resume from in the next call
+    if (aa_template_itr != aa_template_tbl.end()) {
+        print("next: ", aa_template_itr->template_id);
+    } else {
+        print("done");
+    }
+}
+
+ACTION ezstake::resetuser(const name& user)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get users table instance
+    user_t user_tbl(get_self(), get_self().value);
+
+    const auto& user_itr = user_tbl.find(user.value);
+
+    const uint8_t reward_mode = config.reward_mode.value_or(PER_ASSET);
+    const time_point_sec now = current_time_point();
+
+    // the changes to the global stats
+    int64_t removed_users = 0;
+    int64_t removed_power = 0;
+    int64_t forfeited = 0;
+    vector<pair<int32_t, int64_t>> tally = {};
+
+    // erase the user if the it is already registered
+    if (user_itr != user_tbl.end()) {
+        // take the user's power out of the pool
+        if (reward_mode == POOL) {
+            forfeited = get_pool_accrued(*user_itr, update_pool(config, -user_itr->hourly_rate.amount)).amount;
+        } else if (reward_mode == ACCRUAL) {
+            forfeited = get_accrued(config, *user_itr, now).amount;
+        } else {
+            forfeited = get_carried(config, *user_itr).amount;
+        }
+
+        removed_users = 1;
+        removed_power = user_itr->hourly_rate.amount;
+
+        user_tbl.erase(user_itr);
+    }
+
+    // get resets table instance
+    reset_t reset_tbl(get_self(), get_self().value);
+
+    const auto& reset_itr = reset_tbl.find(user.value);
+
+    // drop any unfinished batched reset
+    if (reset_itr != reset_tbl.end()) {
+        reset_tbl.erase(reset_itr);
+    }
+
+    erase_counts(user);
+    erase_extras(user);
+    erase_boosts(user);
+
+    vector<uint64_t> staked_assets = {};
+
+    if (config.storage_mode.value_or(ROWS) == BUCKETS) {
+        // empty the user's buckets
+        bucket_walk(user, 0, UINT32_MAX, [&](const bucket_entry& entry) {
+            tally_template(tally, get_slot_template(entry.slot), -1);
+            staked_assets.push_back(entry.asset_id);
+            return true;
+        });
+    } else {
+        // get asset table instance
+        asset_t asset_tbl(get_self(), get_self().value);
+
+        // iterate through the rows and erase them
+        with_owner_index(config, asset_tbl, user, 0, [&](auto& owner_idx, auto owner_itr) {
+            while (owner_itr != owner_idx.end() && owner_itr->owner == user) {
+                const int32_t template_id = get_template_id(*owner_itr);
+
+                // the unclaimed rewards of the assets are lost
+                if (reward_mode == PER_ASSET) {
+                    forfeited += get_asset_reward(template_id, owner_itr->last_claim, now);
+                }
+
+                tally_template(tally, template_id, -1);
+                staked_assets.push_back(owner_itr->asset_id);
+                owner_itr = owner_idx.erase(owner_itr);
+            }
+        });
+    }
+
+    update_template_stats(tally);
+    update_stats(config, [&](stats_s& row) {
+        add_saturated(row.users, -removed_users);
+        add_saturated(row.staked_assets, -int64_t(staked_assets.size()));
+        add_saturated(row.total_power, -removed_power);
+        release_liability(row, forfeited);
+        update_leaderboard(row, user, 0);
+    });
+
+    // return the assets back to the user if there's any
+    if (staked_assets.size() > 0) {
+        // send the assets back
+        action(permission_level { get_self(), name("active") }, atomicassets::ATOMICASSETS_ACCOUNT, name("transfer"),
+            make_tuple(get_self(), user, staked_assets, string("Unstaking")))
+            .send();
+    }
+
+    send_log(name("logreset"), user, staked_assets, asset(forfeited, token_symbol(config)), asset(0, token_symbol(config)));
+}
+
+ACTION ezstake::resetbatch(const name& user, const uint32_t& max_rows)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the max rows is valid
+    check(max_rows > 0, "max_rows must be positive");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get users table instance
+    user_t user_tbl(get_self(), get_self().value);
+    // get resets table instance
+    reset_t reset_tbl(get_self(), get_self().value);
+
+    const auto& user_itr = user_tbl.find(user.value);
+    auto reset_itr = reset_tbl.find(user.value);
+
+    const uint8_t reward_mode = config.reward_mode.value_or(PER_ASSET);
+    const time_point_sec now = current_time_point();
+
+    // the changes to the global stats
+    int64_t removed_users = 0;
+    int64_t removed_power = 0;
+    int64_t forfeited = 0;
+    vector<pair<int32_t, int64_t>> tally = {};
+
+    // start a new reset
+    if (reset_itr == reset_tbl.end()) {
+        // the users without a checkpoint were staking in per-asset mode
+        // their pending rewards are counted by the batches as they go, instead of walking all their assets up front
+        const bool is_per_asset = reward_mode == PER_ASSET || (reward_mode == ACCRUAL && user_itr != user_tbl.end() && !has_checkpoint(config, *user_itr));
+
+        reset_itr = reset_tbl.emplace(get_self(), [&](reset_s& row) {
+            row.user = user;
+            row.processed = 0;
+            row.started = current_time_point();
+            row.is_per_asset = is_per_asset;
+        });
+
+        // stop the user from generating rewards while being reset
+        if (user_itr != user_tbl.end()) {
+            // take the user's power out of the pool
+            if (reward_mode == POOL) {
+                forfeited = get_pool_accrued(*user_itr, update_pool(config, -user_itr->hourly_rate.amount)).amount;
+            } else if (!is_per_asset) {
+                forfeited = get_checkpoint_accrued(*user_itr, now).amount;
+            } else {
+                forfeited = get_carried(config, *user_itr).amount;
+            }
+
+            removed_power = user_itr->hourly_rate.amount;
+
+            user_tbl.modify(user_itr, same_payer, [&](auto& row) {
+                if (reward_mode != PER_ASSET) {
+                    set_checkpoint(config, row, asset(0, token_symbol(config)), current_time_point());
+                }
+
+                if (reward_mode == POOL) {
+                    row.reward_debt = 0;
+                }
+
+                row.hourly_rate.amount = 0;
+            });
+        }
+
+        erase_counts(user);
+        erase_extras(user);
+        erase_boosts(user);
+    }
+
+    vector<uint64_t> staked_assets = {};
+
+    // the asset id the next batch starts from, 0 if there's no assets left
+    uint64_t cursor = 0;
+
+    if (config.storage_mode.value_or(ROWS) == BUCKETS) {
+        // empty the user's buckets, the emptied buckets are erased
+        cursor = bucket_walk(user, 0, max_rows, [&](const bucket_entry& entry) {
+            const int32_t template_id = get_slot_template(entry.slot);
+
+            // the assets packed from the assets table keep their last claim as their time
+            if (reset_itr->is_per_asset) {
+                forfeited += get_asset_reward(template_id, time_point_sec(entry.time), now);
+            }
+
+            tally_template(tally, template_id, -1);
+            staked_assets.push_back(entry.asset_id);
+            return true;
+        });
+    } else {
+        // get asset table instance
+        asset_t asset_tbl(get_self(), get_self().value);
+
+        // iterate through the rows and erase them
+        // the erased rows are gone, so the next call picks up where this one stopped
+        with_owner_index(config, asset_tbl, user, 0, [&](auto& owner_idx, auto owner_itr) {
+            while (owner_itr != owner_idx.end() && owner_itr->owner == user && staked_assets.size() < max_rows) {
+                const int32_t template_id = get_template_id(*owner_itr);
+
+                // the unclaimed rewards of the assets are lost
+                if (reset_itr->is_per_asset) {
+                    forfeited += get_asset_reward(template_id, owner_itr->last_claim, now);
+                }
+
+                tally_template(tally, template_id, -1);
+                staked_assets.push_back(owner_itr->asset_id);
+                owner_itr = owner_idx.erase(owner_itr);
+            }
+
+            if (owner_itr != owner_idx.end() && owner_itr->owner == user) {
+                cursor = owner_itr->asset_id;
+            }
+        });
+    }
+
+    // finish the reset if there's no assets left
+    if (cursor == 0) {
+        if (user_itr != user_tbl.end()) {
+            removed_users = 1;
+
+            user_tbl.erase(user_itr);
+        }
+
+        reset_tbl.erase(reset_itr);
+
+        print("done");
+    } else {
+        reset_tbl.modify(reset_itr, same_payer, [&](reset_s& row) { row.processed += staked_assets.size(); });
+
+        print("next: ", cursor);
+    }
+
+    update_template_stats(tally);
+    update_stats(config, [&](stats_s& row) {
+        add_saturated(row.users, -removed_users);
+        add_saturated(row.staked_assets, -int64_t(staked_assets.size()));
+        add_saturated(row.total_power, -removed_power);
+        release_liability(row, forfeited);
+        update_leaderboard(row, user, 0);
+    });
+
+    // return this batch of assets back to the user if there's any
+    if (staked_assets.size() > 0) {
+        // send the assets back
+        action(permission_level { get_self(), name("active") }, atomicassets::ATOMICASSETS_ACCOUNT, name("transfer"),
+            make_tuple(get_self(), user, staked_assets, string("Unstaking")))
+            .send();
+    }
+
+    send_log(name("logreset"), user, staked_assets, asset(forfeited, token_symbol(config)), asset(0, token_symbol(config)));
+}
+
+ACTION ezstake::backfill(const uint64_t& from_id, const uint32_t& limit)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the limit is valid
+    check(limit > 0, "limit must be positive");
+
+    // get asset table instance
+    asset_t asset_tbl(get_self(), get_self().value);
+
+    // get the assets table (scoped to the contract)
+    const auto& aa_asset_tbl = atomicassets::get_assets(get_self());
+
+    // get the secondary index
+    auto owner_idx = asset_tbl.get_index<name("ownerasset")>();
+
+    auto asset_itr = asset_tbl.lower_bound(from_id);
+
+    for (uint32_t i = 0; i < limit && asset_itr != asset_tbl.end(); i++) {
+        const bool is_cached = asset_itr->template_id.has_value() && asset_itr->collection.has_value();
+        // rows stored before the owner/asset_id index existed are missing from it
+        const bool is_indexed = owner_idx.find(asset_itr->by_owner_asset()) != owner_idx.end();
+
+        // skip the assets that are already migrated
+        if (is_cached && is_indexed) {
+            asset_itr++;
+            continue;
+        }
+
+        asset_s migrated = *asset_itr;
+
+        if (!is_cached) {
+            // find the asset data, to get the template id from it
+            const auto& aa_asset_itr = aa_asset_tbl.find(asset_itr->asset_id);
+
+            if (aa_asset_itr == aa_asset_tbl.end()) {
+                fail(ASSET_NOT_FOUND, asset_itr->asset_id, [&]() { return string("assert (" + to_string(asset_itr->asset_id) + ") does not exist"); });
+            }
+
+            migrated.template_id = aa_asset_itr->template_id;
+            migrated.collection = aa_asset_itr->collection_name;
+        }
+
+        if (is_indexed) {
+            asset_tbl.modify(asset_itr, same_payer, [&](asset_s& row) { row = migrated; });
+            asset_itr++;
+        } else {
+            // modify only updates the index entries that already exist
+            // so the row is re-inserted to add it to every index
+            asset_itr = asset_tbl.erase(asset_itr);
+            asset_tbl.emplace(get_self(), [&](asset_s& row) { row = migrated; });
+        }
+    }
+
+    // print the cursor to resume from in the next call
+    if (asset_itr != asset_tbl.end()) {
+        print("next: ", asset_itr->asset_id);
+        return;
+    }
+
+    print("done");
+
+    // get config table instance
+    config_t conf_tbl(get_self(), get_self().value);
+
+    // get/create current config
+    auto conf = conf_tbl.get_or_default(config {});
+
+    if (conf.is_indexed.value_or(false)) {
+        return;
+    }
+
+    // the actions walk the ownerasset index from now on
+    // the extensions before is_indexed must be set for it to be serialized
+    conf.reward_mode = conf.reward_mode.value_or(PER_ASSET);
+    conf.storage_mode = conf.storage_mode.value_or(ROWS);
+    conf.hourly_emission = conf.hourly_emission.value_or(asset(0, token_symbol(conf)));
+    conf.min_payout = conf.min_payout.value_or(asset(0, token_symbol(conf)));
+    conf.ram_mode = conf.ram_mode.value_or(CONTRACT_RAM);
+    conf.mode_switches = conf.mode_switches.value_or(0);
+    conf.is_indexed = true;
+
+    // save the new config
+    conf_tbl.set(conf, get_self());
+}
+
+ACTION ezstake::packassets(const uint32_t& limit)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the limit is valid
+    check(limit > 0, "limit must be positive");
+
+    // get config table instance
+    config_t conf_tbl(get_self(), get_self().value);
+
+    check(conf_tbl.get_or_default(config {}).storage_mode.value_or(ROWS) == BUCKETS, "storage mode is not buckets");
+
+    // get asset table instance
+    asset_t asset_tbl(get_self(), get_self().value);
+
+    vector<pair<name, bucket_entry>> packed = {};
+
+    auto asset_itr = asset_tbl.begin();
+
+    for (uint32_t i = 0; i < limit && asset_itr != asset_tbl.end(); i++) {
+        packed.push_back({ asset_itr->owner, bucket_entry { asset_itr->asset_id, get_slot(get_template_id(*asset_itr)), asset_itr->last_claim.sec_since_epoch() } });
+
+        asset_itr = asset_tbl.erase(asset_itr);
+    }
+
+    // group the entries by owner, to write each bucket once
+    std::sort(packed.begin(), packed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (size_t i = 0; i < packed.size();) {
+        const name owner = packed[i].first;
+        vector<bucket_entry> entries = {};
+
+        while (i < packed.size() && packed[i].first == owner) {
+            entries.push_back(packed[i++].second);
+        }
+
+        bucket_insert(owner, entries);
+    }
+
+    if (asset_itr != asset_tbl.end()) {
+        print("next: ", asset_itr->asset_id);
+    } else {
+        print("done");
+    }
+}
+
+ACTION ezstake::rerate(const int32_t& template_id, const name& from_user, const uint32_t& max_rows)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the max rows is valid
+    check(max_rows > 0, "max_rows must be positive");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get rerates table instance
+    rerate_t rerate_tbl(get_self(), get_self().value);
+
+    const auto& rerate_itr = rerate_tbl.find(uint64_t(template_id));
+
+    // check if the template has a pending rate change
+    if (rerate_itr == rerate_tbl.end()) {
+        fail(TEMPLATE_NOT_RERATING, template_id, [&]() { return string("template (" + to_string(template_id) + ") is not pending a re-rate"); });
+    }
+
+    // get users table instance
+    user_t user_tbl(get_self(), get_self().value);
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+    // get counts table instance
+    count_t count_tbl(get_self(), get_self().value);
+
+    // the users of a removed template are moved to a zero rate
+    const template_s target = get_rerate_target(template_tbl, template_id, token_symbol(config));
+
+    // get the secondary index
+    auto count_idx = count_tbl.get_index<name("templateuser")>();
+    auto count_itr = count_idx.lower_bound(template_user_key(template_id, from_user));
+
+    // the assets of a re-added template that go back into its staked counter
+    int64_t readded = 0;
+
+    for (uint32_t i = 0; i < max_rows && count_itr != count_idx.end() && count_itr->template_id == template_id; i++, count_itr++) {
+        // skip the users already re-rated
+        if (is_rerated(*count_itr, target)) {
+            continue;
+        }
+
+        const asset delta = asset(int64_t(count_itr->count) * (target.hourly_rate.amount - count_itr->hourly_rate.amount), token_symbol(config));
+
+        vector<extended_asset> extra_delta = {};
+        add_rates(extra_delta, target.extra_rates.value_or(), int64_t(count_itr->count));
+        add_rates(extra_delta, count_itr->extra_rates.value_or(), -int64_t(count_itr->count));
+
+        // only the counts re-rated on a removal have a zero rate
+        if (count_itr->hourly_rate.amount == 0) {
+            readded += int64_t(count_itr->count);
+        }
+
+        count_idx.modify(count_itr, same_payer, [&](count_s& row) {
+            row.hourly_rate = target.hourly_rate;
+            row.extra_rates = target.extra_rates.value_or();
+        });
+
+        const auto& user_itr = user_tbl.find(count_itr->user.value);
+
+        if (user_itr != user_tbl.end()) {
+            if (delta.amount != 0) {
+                change_rate(config, user_tbl, user_itr, delta);
+            }
+
+            change_extra_rates(count_itr->user, extra_delta);
+            update_boosts(config, user_tbl, user_itr, { { template_id, 0 } });
+        }
+    }
+
+    if (readded > 0) {
+        update_template_stats({ { template_id, readded } });
+    }
+
+    // print the cursor to resume from in the next call
+    if (count_itr != count_idx.end() && count_itr->template_id == template_id) {
+        print("next: ", count_itr->user);
+    } else {
+        // every user is on the new rate
+        rerate_tbl.erase(rerate_itr);
+
+        print("done");
+    }
+}
+
+ACTION ezstake::recount(const name& user)
+{
+    // check contract auth
+    check(has_auth(get_self()), "this action is admin only");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get users table instance
+    user_t user_tbl(get_self(), get_self().value);
+
+    const auto& user_itr = user_tbl.find(user.value);
+
+    // check if the user is registered
+    if (user_itr == user_tbl.end()) {
+        fail(USER_NOT_REGISTERED, 0, [&]() { return string("user " + user.to_string() + " is not registered"); });
+    }
+
+    // check if the user isn't being reset
+    check_not_resetting(user);
+
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+
+    vector<pair<int32_t, int64_t>> tally = {};
+
+    // count the user's assets per template
+    if (config.storage_mode.value_or(ROWS) == BUCKETS) {
+        bucket_walk(user, 0, UINT32_MAX, [&](const bucket_entry& entry) {
+            tally_template(tally, get_slot_template(entry.slot), 1);
+            return false;
+        });
+    } else {
+        // get asset table instance
+        asset_t asset_tbl(get_self(), get_self().value);
+
+        with_owner_index(config, asset_tbl, user, 0, [&](auto& owner_idx, auto owner_itr) {
+            for (; owner_itr != owner_idx.end() && owner_itr->owner == user; owner_itr++) {
+                tally_template(tally, get_template_id(*owner_itr), 1);
+            }
+        });
+    }
+
+    // replace the user's counts, and the extra rates they add up to
+    clear_extra_rates(user);
+    erase_counts(user);
+    update_counts(user, tally);
+
+    // the user's rate is the sum of the counted assets at their template's current rate
+    asset hourly_rate = asset(0, token_symbol(config));
+
+    for (const auto& [template_id, count] : tally) {
+        const auto& template_itr = template_tbl.find(uint64_t(template_id));
+
+        if (template_itr != template_tbl.end()) {
+            hourly_rate.amount += count * template_itr->hourly_rate.amount;
+        }
+    }
+
+    // the boosts are added back from the new counts
+    erase_boosts(user);
+
+    change_rate(config, user_tbl, user_itr, hourly_rate - user_itr->hourly_rate);
+    update_boosts(config, user_tbl, user_itr, tally);
+}
+
+ACTION ezstake::regnewuser(const name& user)
+{
+    // check user auth
+    if (!has_auth(user)) {
+        fail(USER_NOT_AUTHORIZED, 0, [&]() { return string("user " + user.to_string() + " has not authorized this action"); });
+    }
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get users table instance
+    user_t user_tbl(get_self(), get_self().value);
+
+    const auto& user_itr = user_tbl.find(user.value);
+
+    // check if the user isn't already registered
+    if (user_itr != user_tbl.end()) {
+        fail(USER_ALREADY_REGISTERED, 0, [&]() { return string("user " + user.to_string() + " is already registered"); });
+    }
+
+    user_tbl.emplace(user, [&](user_s& row) {
+        row.user = user;
+        row.hourly_rate = asset(0, token_symbol(config));
+
+        // start accruing right away
+        if (config.reward_mode.value_or(PER_ASSET) != PER_ASSET) {
+            set_checkpoint(config, row, asset(0, token_symbol(config)), current_time_point());
+        }
+    });
+
+    update_stats(config, [](stats_s& row) { row.users++; });
+}
+
+ACTION ezstake::depositram(const name& user, const uint32_t& bytes)
+{
+    // check user auth
+    if (!has_auth(user)) {
+        fail(USER_NOT_AUTHORIZED, 0, [&]() { return string("user " + user.to_string() + " has not authorized this action"); });
+    }
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    check(config.ram_mode.value_or(CONTRACT_RAM) == USER_RAM, "RAM deposits are disabled");
+    check(bytes > 0, "bytes must be positive");
+
+    // get deposits table instance
+    ramdeposit_t deposit_tbl(get_self(), get_self().value);
+
+    auto deposit_itr = deposit_tbl.find(user.value);
+
+    if (deposit_itr == deposit_tbl.end()) {
+        deposit_itr = deposit_tbl.emplace(user, [&](ramdeposit_s& row) { row.user = user; });
+    }
+
+    // grow the padding, billed to the user
+    deposit_tbl.modify(deposit_itr, user, [&](ramdeposit_s& row) { row.reserved.resize(row.reserved.size() + bytes); });
+}
+
+ACTION ezstake::withdrawram(const name& user, const uint32_t& bytes)
+{
+    // check user auth
+    if (!has_auth(user)) {
+        fail(USER_NOT_AUTHORIZED, 0, [&]() { return string("user " + user.to_string() + " has not authorized this action"); });
+    }
+
+    // the deposits can be withdrawn in any RAM mode, so a switch back to the contract RAM doesn't lock them
+    check(bytes > 0, "bytes must be positive");
+
+    // get deposits table instance
+    ramdeposit_t deposit_tbl(get_self(), get_self().value);
+
+    const auto& deposit_itr = deposit_tbl.find(user.value);
+
+    // check if the user deposited enough
+    if (deposit_itr == deposit_tbl.end() || deposit_itr->reserved.size() < bytes) {
+        fail(RAM_NOT_WITHDRAWABLE, bytes, [&]() { return string("user " + user.to_string() + " has not deposited " + to_string(bytes) + " bytes"); });
+    }
+
+    // remove the deposit once it's empty
+    if (deposit_itr->reserved.size() == bytes) {
+        deposit_tbl.erase(deposit_itr);
+    } else {
+        deposit_tbl.modify(deposit_itr, same_payer, [&](ramdeposit_s& row) { row.reserved.resize(row.reserved.size() - bytes); });
+    }
+}
+
+ACTION ezstake::claim(const name& user, const vector<uint64_t>& asset_ids)
+{
+    // check user auth
+    if (!has_auth(user)) {
+        fail(USER_NOT_AUTHORIZED, 0, [&]() { return string("user " + user.to_string() + " has not authorized this action"); });
+    }
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    // get users table instance
+    user_t user_tbl(get_self(), get_self().value);
+
+    const auto& user_itr = user_tbl.find(user.value);
+
+    // check if the user is registered
+    if (user_itr == user_tbl.end()) {
+        fail(USER_NOT_REGISTERED, 0, [&]() { return string("user " + user.to_string() + " is not registered"); });
+    }
+
+    // check if the user isn't being reset
+    check_not_resetting(user);
+
+    // apply the pending rate changes
+    rerate_user(config, user_tbl, user_itr);
+
+    asset claimed_amount = asset(0, token_symbol(config));
+
+    // the claimed assets, for the log (per-asset mode only)
+    vector<uint64_t> claimed_assets = {};
+
+    const uint8_t reward_mode = config.reward_mode.value_or(PER_ASSET);
+
+    if (reward_mode != PER_ASSET) {
+        const time_point_sec now = current_time_point();
+
+        // check if the user is not in cooldown
+        if (now.sec_since_epoch() - user_itr->last_claim.value_or().sec_since_epoch() < min_claim_period(config)) {
+            fail(USER_IN_COOLDOWN, 0, [&]() { return string("user " + user.to_string() + " is still in cooldown"); });
+        }
+
+        // settle the pool up to now
+        const pool_s pool = reward_mode == POOL ? update_pool(config, 0) : pool_s {};
+
+        // claim everything the user accrued so far
+        claimed_amount = settle_user(config, user_tbl, user_itr, pool, now);
+    } else {
+        // get template table instance
+        template_t template_tbl(get_self(), get_self().value);
+        // get asset table instance
+        asset_t asset_tbl(get_self(), get_self().value);
+
+        const time_point_sec now = current_time_point();
+        vector<cached_template> templates = {};
 
-    conf.token_contract = contract;
-    conf.token_symbol = symbol;
+        for (const uint64_t& asset_id : sort_batch(asset_ids)) {
+            // find the staked asset
+            const auto& asset_itr = asset_tbl.find(asset_id);
 
-    // save the new config
-    conf_tbl.set(conf, get_self());
-}
+            // check if the asset is staked
+            if (asset_itr == asset_tbl.end()) {
+                fail(ASSET_NOT_STAKED, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") is not staked"); });
+            }
 
-ACTION ezstake::addtemplates(const std::vector<template_item>& templates)
-{
-    // check contract auth
-    check(has_auth(get_self()), "this action is admin only");
+            // check if the asset belongs to the user
+            if (asset_itr->owner != user) {
+                fail(ASSET_NOT_OWNED, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") does not belong to " + user.to_string()); });
+            }
 
-    // check if the contract isn't frozen
-    const auto& config = check_config();
+            // check if the asset's template is stakeable
+            cached_template* cached = find_cached(templates, template_tbl, get_template_id(*asset_itr));
 
-    // get templates table instance
-    template_t template_tbl(get_self(), get_self().value);
+            if (cached == nullptr) {
+                fail(ASSET_NOT_STAKEABLE, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") is not stakeable"); });
+            }
 
-    for (const template_item& t : templates) {
-        // check if the hourly rate is valid
-        check(t.hourly_rate.amount > 0, "hourly_rate must be positive");
-        check(config.token_symbol == t.hourly_rate.symbol, "symbol mismatch");
+            auto period_sec = now.sec_since_epoch() - asset_itr->last_claim.sec_since_epoch();
 
-        // check if the template exists in atomicassets and it's valid
-        const auto& aa_template_tbl = atomicassets::get_templates(t.collection);
+            // check if the asset is not in cooldown
+            if (period_sec < min_claim_period(config)) {
+                fail(ASSET_IN_COOLDOWN, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") is still in cooldown"); });
+            }
 
-        const auto& aa_template_itr = aa_template_tbl.find(uint64_t(t.template_id));
+            // increment the claimed amount
+            claimed_amount += asset(get_cached_reward(*cached, asset_itr->last_claim, now), token_symbol(config));
 
-        if (aa_template_itr == aa_template_tbl.end()) {
-            check(false, string("template (" + to_string(t.template_id) + ") not found in collection " + t.collection.to_string()).c_str());
+            // reset the last claim time
+            asset_tbl.modify(asset_itr, same_payer, [&](asset_s& row) { row.last_claim = now; });
         }
 
-        const auto& template_row = template_tbl.find(uint64_t(t.template_id));
+        claimed_assets = asset_ids;
 
-        // insert the new template or update it if it already exists
-        if (template_row == template_tbl.end()) {
-            template_tbl.emplace(get_self(), [&](template_s& row) {
-                row.template_id = t.template_id;
-                row.collection = t.collection;
-                row.hourly_rate = t.hourly_rate;
-            });
-        } else {
-            template_tbl.modify(template_row, get_self(), [&](template_s& row) {
-                row.template_id = t.template_id;
-                row.collection = t.collection;
-                row.hourly_rate = t.hourly_rate;
-            });
-        }
+        // pay the rewards left from a per-user mode along
+        claimed_amount += take_carried(user_tbl, user_itr);
     }
-}
-
-ACTION ezstake::rmtemplates(const std::vector<template_item>& templates)
-{
-    // check contract auth
-    check(has_auth(get_self()), "this action is admin only");
 
-    // check if the contract isn't frozen
-    const auto& config = check_config();
+    // pay the extra tokens along
+    const bool has_extras = pay_extras(config, user, current_time_point());
 
-    // get templates table instance
-    template_t template_tbl(get_self(), get_self().value);
+    // fail if the reward is 0
+    check(claimed_amount.amount > 0 || has_extras, "nothing to claim");
 
-    for (const template_item& t : templates) {
-        const auto& template_row = template_tbl.find(uint64_t(t.template_id));
+    if (claimed_amount.amount > 0) {
+        update_stats(config, [&](stats_s& row) {
+            row.total_claimed += claimed_amount.amount;
+            release_liability(row, claimed_amount.amount);
+        });
 
-        // erase the template if it already exists
-        if (template_row != template_tbl.end()) {
-            template_tbl.erase(template_row);
-        }
+        // send the tokens
+        action(permission_level { get_self(), name("active") }, token_contract(config), name("transfer"),
+            make_tuple(get_self(), user, claimed_amount, string("Staking reward")))
+            .send();
     }
+
+    send_log(name("logclaim"), user, claimed_assets, claimed_amount, user_itr->hourly_rate);
 }
 
-ACTION ezstake::resetuser(const name& user)
+ACTION ezstake::unstake(const name& user, const vector<uint64_t>& asset_ids)
 {
-    // check contract auth
-    check(has_auth(get_self()), "this action is admin only");
+    // check user auth
+    if (!has_auth(user)) {
+        fail(USER_NOT_AUTHORIZED, 0, [&]() { return string("user " + user.to_string() + " has not authorized this action"); });
+    }
+
+    // check if there's any requested asset_ids at all
+    check(asset_ids.size() > 0, "must unstake at least 1 asset");
 
     // check if the contract isn't frozen
     const auto& config = check_config();
@@ -141,68 +1437,214 @@ ACTION ezstake::resetuser(const name& user)
 
     const auto& user_itr = user_tbl.find(user.value);
 
-    // erase the user if the it is already registered
-    if (user_itr != user_tbl.end()) {
-        user_tbl.erase(user_itr);
+    // check if the user is registered
+    if (user_itr == user_tbl.end()) {
+        fail(USER_NOT_REGISTERED, 0, [&]() { return string("user " + user.to_string() + " is not registered"); });
     }
 
+    // check if the user isn't being reset
+    check_not_resetting(user);
+
+    // apply the pending rate changes
+    rerate_user(config, user_tbl, user_itr);
+
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
     // get asset table instance
     asset_t asset_tbl(get_self(), get_self().value);
 
-    vector<uint64_t> staked_assets = {};
+    asset removed_rate = asset(0, token_symbol(config));
+    vector<pair<int32_t, int64_t>> tally = {};
 
-    // get the secondary index
-    auto owner_idx = asset_tbl.get_index<name("owner")>();
-    auto owner_itr = owner_idx.lower_bound(user.value);
+    // the unclaimed rewards of the unstaked assets are lost in per-asset mode
+    const bool is_per_asset = config.reward_mode.value_or(PER_ASSET) == PER_ASSET;
+    int64_t forfeited = 0;
 
-    // iterate through the rows and erase them
-    while (owner_itr != owner_idx.end() && owner_itr->owner == user) {
-        staked_assets.push_back(owner_itr->asset_id);
-        owner_idx.erase(owner_itr++);
-    }
+    const time_point_sec now = current_time_point();
+    const vector<uint64_t> sorted_ids = sort_batch(asset_ids);
+    vector<cached_template> templates = {};
 
-    // return the assets back to the user if there's any
-    if (staked_assets.size() > 0) {
-        // send the assets back
-        action(permission_level { get_self(), name("active") }, atomicassets::ATOMICASSETS_ACCOUNT, name("transfer"),
-            make_tuple(get_self(), user, staked_assets, string("Unstaking")))
-            .send();
+    if (config.storage_mode.value_or(ROWS) == BUCKETS) {
+        // remove the assets from the user's buckets
+        // the buckets only hold the user's assets, so another user's asset is simply not found
+        for (const bucket_entry& entry : bucket_remove(user, sorted_ids)) {
+            // check if the asset's template is stakeable
+            const cached_template* cached = find_cached(templates, template_tbl, get_slot_template(entry.slot));
+
+            if (cached == nullptr) {
+                fail(ASSET_NOT_STAKEABLE, entry.asset_id, [&]() { return string("asset (" + to_string(entry.asset_id) + ") is not stakeable"); });
+            }
+
+            // check if the asset can be unstaked
+            if (now.sec_since_epoch() - entry.time < unstake_period(config)) {
+                fail(ASSET_LOCKED, entry.asset_id, [&]() { return string("asset (" + to_string(entry.asset_id) + ") cannot be unstaked yet"); });
+            }
+
+            // increment the removed amount
+            removed_rate += cached->row.hourly_rate;
+            tally_template(tally, cached->template_id, -1);
+        }
+    } else {
+        for (const uint64_t& asset_id : sorted_ids) {
+            // find the staked asset
+            const auto& asset_itr = asset_tbl.find(asset_id);
+
+            // check if the asset is staked
+            if (asset_itr == asset_tbl.end()) {
+                fail(ASSET_NOT_STAKED, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") is not staked"); });
+            }
+
+            // check if the asset belongs to the user
+            if (asset_itr->owner != user) {
+                fail(ASSET_NOT_OWNED, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") does not belong to " + user.to_string()); });
+            }
+
+            // check if the asset's template is stakeable
+            cached_template* cached = find_cached(templates, template_tbl, get_template_id(*asset_itr));
+
+            if (cached == nullptr) {
+                fail(ASSET_NOT_STAKEABLE, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") is not stakeable"); });
+            }
+
+            auto period_sec = now.sec_since_epoch() - asset_itr->last_claim.sec_since_epoch();
+
+            // check if the asset can be unstaked
+            if (period_sec < unstake_period(config)) {
+                fail(ASSET_LOCKED, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") cannot be unstaked yet"); });
+            }
+
+            // increment the removed amount
+            removed_rate += cached->row.hourly_rate;
+            tally_template(tally, cached->template_id, -1);
+
+            if (is_per_asset) {
+                forfeited += get_cached_reward(*cached, asset_itr->last_claim, now);
+            }
+
+            // remove the assets from the user's staked assets
+            asset_tbl.erase(asset_itr);
+        }
     }
+
+    // save the new rate and send the assets back
+    send_unstaked(config, user_tbl, user_itr, removed_rate, tally, asset_ids, forfeited);
 }
 
-ACTION ezstake::regnewuser(const name& user)
+ACTION ezstake::claimall(const name& user, const uint64_t& from_id, const uint32_t& max_rows)
 {
     // check user auth
     if (!has_auth(user)) {
-        check(false, string("user " + user.to_string() + " has not authorized this action").c_str());
+        fail(USER_NOT_AUTHORIZED, 0, [&]() { return string("user " + user.to_string() + " has not authorized this action"); });
     }
 
+    // check if the max rows is valid
+    check(max_rows > 0, "max_rows must be positive");
+
     // check if the contract isn't frozen
     const auto& config = check_config();
 
+    // the per-user modes don't need to walk the assets
+    if (config.reward_mode.value_or(PER_ASSET) != PER_ASSET) {
+        claim(user, {});
+        return;
+    }
+
     // get users table instance
     user_t user_tbl(get_self(), get_self().value);
 
     const auto& user_itr = user_tbl.find(user.value);
 
-    // check if the user isn't already registered
-    if (user_itr != user_tbl.end()) {
-        check(false, string("user " + user.to_string() + " is already registered").c_str());
+    // check if the user is registered
+    if (user_itr == user_tbl.end()) {
+        fail(USER_NOT_REGISTERED, 0, [&]() { return string("user " + user.to_string() + " is not registered"); });
     }
 
-    user_tbl.emplace(user, [&](user_s& row) {
-        row.user = user;
-        row.hourly_rate = asset(0, config.token_symbol);
+    // check if the user isn't being reset
+    check_not_resetting(user);
+
+    // apply the pending rate changes
+    rerate_user(config, user_tbl, user_itr);
+
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+    // get asset table instance
+    asset_t asset_tbl(get_self(), get_self().value);
+
+    asset claimed_amount = asset(0, token_symbol(config));
+    vector<uint64_t> claimed_assets = {};
+
+    const time_point_sec now = current_time_point();
+
+    vector<cached_template> templates = {};
+
+    // the asset id the next call starts from, 0 if there's no assets left
+    uint64_t cursor = 0;
+
+    with_owner_index(config, asset_tbl, user, from_id, [&](auto& owner_idx, auto owner_itr) {
+        for (uint32_t i = 0; i < max_rows && owner_itr != owner_idx.end() && owner_itr->owner == user; i++, owner_itr++) {
+            cached_template* cached = find_cached(templates, template_tbl, get_template_id(*owner_itr));
+
+            auto period_sec = now.sec_since_epoch() - owner_itr->last_claim.sec_since_epoch();
+
+            // skip the assets that can't be claimed
+            if (cached == nullptr || period_sec < min_claim_period(config)) {
+                continue;
+            }
+
+            // increment the claimed amount
+            claimed_amount += asset(get_cached_reward(*cached, owner_itr->last_claim, now), token_symbol(config));
+
+            // reset the last claim time
+            owner_idx.modify(owner_itr, same_payer, [&](asset_s& row) { row.last_claim = now; });
+            claimed_assets.push_back(owner_itr->asset_id);
+        }
+
+        if (owner_itr != owner_idx.end() && owner_itr->owner == user) {
+            cursor = owner_itr->asset_id;
+        }
     });
+
+    // print the cursor to resume from in the next call
+    if (cursor != 0) {
+        print("next: ", cursor);
+    } else {
+        print("done");
+    }
+
+    // pay the rewards left from a per-user mode along
+    claimed_amount += take_carried(user_tbl, user_itr);
+
+    // pay the extra tokens along
+    const bool has_extras = pay_extras(config, user, now);
+
+    // fail if the reward is 0
+    check(claimed_amount.amount > 0 || has_extras, "nothing to claim");
+
+    if (claimed_amount.amount > 0) {
+        update_stats(config, [&](stats_s& row) {
+            row.total_claimed += claimed_amount.amount;
+            release_liability(row, claimed_amount.amount);
+        });
+
+        // send the tokens
+        action(permission_level { get_self(), name("active") }, token_contract(config), name("transfer"),
+            make_tuple(get_self(), user, claimed_amount, string("Staking reward")))
+            .send();
+    }
+
+    send_log(name("logclaim"), user, claimed_assets, claimed_amount, user_itr->hourly_rate);
 }
 
-ACTION ezstake::claim(const name& user, const vector<uint64_t>& asset_ids)
+ACTION ezstake::unstakeall(const name& user, const uint64_t& from_id, const uint32_t& max_rows)
 {
     // check user auth
     if (!has_auth(user)) {
-        check(false, string("user " + user.to_string() + " has not authorized this action").c_str());
+        fail(USER_NOT_AUTHORIZED, 0, [&]() { return string("user " + user.to_string() + " has not authorized this action"); });
     }
 
+    // check if the max rows is valid
+    check(max_rows > 0, "max_rows must be positive");
+
     // check if the contract isn't frozen
     const auto& config = check_config();
 
@@ -213,82 +1655,220 @@ ACTION ezstake::claim(const name& user, const vector<uint64_t>& asset_ids)
 
     // check if the user is registered
     if (user_itr == user_tbl.end()) {
-        check(false, string("user " + user.to_string() + " is not registered").c_str());
+        fail(USER_NOT_REGISTERED, 0, [&]() { return string("user " + user.to_string() + " is not registered"); });
     }
 
+    // check if the user isn't being reset
+    check_not_resetting(user);
+
+    // apply the pending rate changes
+    rerate_user(config, user_tbl, user_itr);
+
     // get template table instance
     template_t template_tbl(get_self(), get_self().value);
     // get asset table instance
     asset_t asset_tbl(get_self(), get_self().value);
 
-    asset claimed_amount = asset(0, config.token_symbol);
+    asset removed_rate = asset(0, token_symbol(config));
+    vector<pair<int32_t, int64_t>> tally = {};
+    vector<uint64_t> unstaked_assets = {};
 
-    // get the assets table (scoped to the contract)
-    const auto& aa_asset_tbl = atomicassets::get_assets(get_self());
+    // the unclaimed rewards of the unstaked assets are lost in per-asset mode
+    const bool is_per_asset = config.reward_mode.value_or(PER_ASSET) == PER_ASSET;
+    int64_t forfeited = 0;
 
-    for (const uint64_t& asset_id : asset_ids) {
-        // find the asset data, to get the template id from it
-        const auto& asset_itr = asset_tbl.find(asset_id);
+    const time_point_sec now = current_time_point();
+
+    // the asset id to resume from, 0 if there's no assets left
+    uint64_t cursor = 0;
+
+    vector<cached_template> templates = {};
+
+    if (config.storage_mode.value_or(ROWS) == BUCKETS) {
+        cursor = bucket_walk(user, from_id, max_rows, [&](const bucket_entry& entry) {
+            const cached_template* cached = find_cached(templates, template_tbl, get_slot_template(entry.slot));
+
+            // skip the assets that can't be unstaked
+            if (cached == nullptr || now.sec_since_epoch() - entry.time < unstake_period(config)) {
+                return false;
+            }
+
+            // increment the removed amount
+            removed_rate += cached->row.hourly_rate;
+            tally_template(tally, cached->template_id, -1);
+
+            // remove the assets from the user's staked assets
+            unstaked_assets.push_back(entry.asset_id);
+            return true;
+        });
+    } else {
+        with_owner_index(config, asset_tbl, user, from_id, [&](auto& owner_idx, auto owner_itr) {
+            for (uint32_t i = 0; i < max_rows && owner_itr != owner_idx.end() && owner_itr->owner == user; i++) {
+                cached_template* cached = find_cached(templates, template_tbl, get_template_id(*owner_itr));
+
+                auto period_sec = now.sec_since_epoch() - owner_itr->last_claim.sec_since_epoch();
+
+                // skip the assets that can't be unstaked
+                if (cached == nullptr || period_sec < unstake_period(config)) {
+                    owner_itr++;
+                    continue;
+                }
+
+                // increment the removed amount
+                removed_rate += cached->row.hourly_rate;
+                tally_template(tally, cached->template_id, -1);
+
+                if (is_per_asset) {
+                    forfeited += get_cached_reward(*cached, owner_itr->last_claim, now);
+                }
+
+                // remove the assets from the user's staked assets
+                unstaked_assets.push_back(owner_itr->asset_id);
+                owner_itr = owner_idx.erase(owner_itr);
+            }
+
+            if (owner_itr != owner_idx.end() && owner_itr->owner == user) {
+                cursor = owner_itr->asset_id;
+            }
+        });
+    }
+
+    // print the cursor to resume from in the next call
+    if (cursor != 0) {
+        print("next: ", cursor);
+    } else {
+        print("done");
+    }
+
+    // fail if there's no assets to unstake
+    check(unstaked_assets.size() > 0, "nothing to unstake");
+
+    // save the new rate and send the assets back
+    send_unstaked(config, user_tbl, user_itr, removed_rate, tally, unstaked_assets, forfeited);
+}
+
+ACTION ezstake::crank(const uint32_t& max_users)
+{
+    // check if the max users is valid
+    check(max_users > 0, "max_users must be positive");
+
+    // check if the contract isn't frozen
+    const auto& config = check_config();
+
+    const uint8_t reward_mode = config.reward_mode.value_or(PER_ASSET);
+
+    // the per-asset rewards would need to walk every asset
+    check(reward_mode != PER_ASSET, "auto-payout requires a per-user reward mode");
+
+    const int64_t min_payout = config.min_payout.value_or(asset()).amount;
+
+    check(min_payout > 0, "auto-payout is disabled");
+
+    // get users table instance
+    user_t user_tbl(get_self(), get_self().value);
+    // get payout table instance
+    payout_t payout_tbl(get_self(), get_self().value);
+
+    auto payout = payout_tbl.get_or_default();
+
+    const time_point_sec now = current_time_point();
+
+    // settle the pool once for all the users
+    const pool_s pool = reward_mode == POOL ? update_pool(config, 0) : pool_s {};
 
-        // check if the asset is staked
-        if (asset_itr == asset_tbl.end()) {
-            check(false, string("asset (" + to_string(asset_id) + ") is not staked").c_str());
+    asset paid_amount = asset(0, token_symbol(config));
+
+    auto user_itr = user_tbl.lower_bound(payout.cursor.value);
+    bool is_wrapped = false;
+
+    for (uint32_t i = 0; i < max_users && user_tbl.begin() != user_tbl.end(); i++, user_itr++) {
+        // start over from the first user
+        if (user_itr == user_tbl.end()) {
+            user_itr = user_tbl.begin();
+            is_wrapped = true;
         }
 
-        // check if the asset belongs to the user
-        if (asset_itr->owner != user) {
-            check(false, string("asset (" + to_string(asset_id) + ") does not belong to " + user.to_string()).c_str());
+        // every user was visited once
+        if (is_wrapped && user_itr->user >= payout.cursor) {
+            break;
         }
 
-        // find the asset data, to get the template id from it
-        const auto& aa_asset_itr = aa_asset_tbl.find(asset_id);
+        // skip the users in cooldown, like their own claim would
+        if (now.sec_since_epoch() - user_itr->last_claim.value_or().sec_since_epoch() < min_claim_period(config)) {
+            continue;
+        }
 
-        if (aa_asset_itr == aa_asset_tbl.end()) {
-            check(false, string("assert (" + to_string(asset_id) + ") does not exist").c_str());
+        // skip the users staking since an earlier mode, their rewards would be summed from all their assets
+        // they get a checkpoint on their next action (or a recount)
+        if (reward_mode == ACCRUAL && !has_checkpoint(config, *user_itr)) {
+            continue;
         }
 
-        // check if the asset's template is stakeable
-        const auto& template_itr = template_tbl.find(aa_asset_itr->template_id);
+        const asset pending = reward_mode == POOL ? get_pool_accrued(*user_itr, pool) : get_accrued(config, *user_itr, now);
 
-        if (template_itr == template_tbl.end()) {
-            check(false, string("asset (" + to_string(asset_id) + ") is not stakeable").c_str());
+        // skip the users below the threshold
+        if (pending.amount < min_payout) {
+            continue;
         }
 
-        auto period_sec = current_time_point().sec_since_epoch() - asset_itr->last_claim.sec_since_epoch();
+        const asset claimed = settle_user(config, user_tbl, user_itr, pool, now);
 
-        // check if the asset is not in cooldown
-        if (period_sec < config.min_claim_period) {
-            check(false, string("asset (" + to_string(asset_id) + ") is still in cooldown").c_str());
-        }
+        paid_amount += claimed;
 
-        // increment the claimed amount
-        claimed_amount.amount += (template_itr->hourly_rate.amount * period_sec) / 3600;
+        // send the tokens
+        action(permission_level { get_self(), name("active") }, token_contract(config), name("transfer"),
+            make_tuple(get_self(), user_itr->user, claimed, string("Staking reward")))
+            .send();
+
+        // pay the extra tokens along
+        pay_extras(config, user_itr->user, now);
 
-        // reset the last claim time
-        asset_tbl.modify(asset_itr, user, [&](asset_s& row) { row.last_claim = current_time_point(); });
+        send_log(name("logclaim"), user_itr->user, {}, claimed, user_itr->hourly_rate);
     }
 
-    // fail if the reward is 0
-    check(claimed_amount.amount > 0, "nothing to claim");
+    // save where the next call starts from
+    payout.cursor = user_itr != user_tbl.end() ? user_itr->user : name();
+    payout_tbl.set(payout, get_self());
 
-    // send the tokens
-    action(permission_level { get_self(), name("active") }, config.token_contract, name("transfer"),
-        make_tuple(get_self(), user, claimed_amount, string("Staking reward")))
-        .send();
+    if (paid_amount.amount > 0) {
+        update_stats(config, [&](stats_s& row) {
+            row.total_claimed += paid_amount.amount;
+            release_liability(row, paid_amount.amount);
+        });
+    }
 }
 
-ACTION ezstake::unstake(const name& user, const vector<uint64_t>& asset_ids)
+ACTION ezstake::logstake(const name&, const vector<uint64_t>&, const asset&, const asset&, const uint64_t&)
 {
-    // check user auth
-    if (!has_auth(user)) {
-        check(false, string("user " + user.to_string() + " has not authorized this action").c_str());
-    }
+    // only sent by the contract itself, the payload is only read from the action traces
+    check(has_auth(get_self()), "this action is admin only");
+}
 
-    // check if there's any requested asset_ids at all
-    check(asset_ids.size() > 0, "must unstake at least 1 asset");
+ACTION ezstake::logclaim(const name&, const vector<uint64_t>&, const asset&, const asset&, const uint64_t&)
+{
+    // only sent by the contract itself, the payload is only read from the action traces
+    check(has_auth(get_self()), "this action is admin only");
+}
 
-    // check if the contract isn't frozen
-    const auto& config = check_config();
+ACTION ezstake::logunstake(const name&, const vector<uint64_t>&, const asset&, const asset&, const uint64_t&)
+{
+    // only sent by the contract itself, the payload is only read from the action traces
+    check(has_auth(get_self()), "this action is admin only");
+}
+
+ACTION ezstake::logreset(const name&, const vector<uint64_t>&, const asset&, const asset&, const uint64_t&)
+{
+    // only sent by the contract itself, the payload is only read from the action traces
+    check(has_auth(get_self()), "this action is admin only");
+}
+
+ezstake::pending_result ezstake::getpending(const name& user, const uint64_t& cursor, const uint32_t& limit)
+{
+    // check if the limit is valid
+    check(limit > 0, "limit must be positive");
+
+    // the pending rewards can be read even while the contract is frozen
+    const auto& conf = read_config();
 
     // get users table instance
     user_t user_tbl(get_self(), get_self().value);
@@ -297,74 +1877,73 @@ ACTION ezstake::unstake(const name& user, const vector<uint64_t>& asset_ids)
 
     // check if the user is registered
     if (user_itr == user_tbl.end()) {
-        check(false, string("user " + user.to_string() + " is not registered").c_str());
+        fail(USER_NOT_REGISTERED, 0, [&]() { return string("user " + user.to_string() + " is not registered"); });
     }
 
-    // get template table instance
-    template_t template_tbl(get_self(), get_self().value);
-    // get asset table instance
-    asset_t asset_tbl(get_self(), get_self().value);
+    const time_point_sec now = current_time_point();
+    const uint8_t reward_mode = conf.reward_mode.value_or(PER_ASSET);
 
-    asset removed_rate = asset(0, config.token_symbol);
+    pending_result result = {};
+    result.total = asset(0, token_symbol(conf));
+    result.extras = get_extras_accrued(user, now);
 
-    // get the assets table (scoped to the contract)
-    const auto& aa_asset_tbl = atomicassets::get_assets(get_self());
+    // the per-user modes claim everything at once
+    if (reward_mode != PER_ASSET) {
+        result.total = reward_mode == POOL ? get_pool_accrued(*user_itr, peek_pool(conf)) : get_accrued(conf, *user_itr, now);
+        result.claimable_at = user_itr->last_claim.value_or() + min_claim_period(conf);
 
-    for (const uint64_t& asset_id : asset_ids) {
-        // find the asset data, to get the template id from it
-        const auto& asset_itr = asset_tbl.find(asset_id);
+        return result;
+    }
 
-        // check if the asset is staked
-        if (asset_itr == asset_tbl.end()) {
-            check(false, string("asset (" + to_string(asset_id) + ") is not staked").c_str());
-        }
+    // the rewards left from a per-user mode are paid along the first claim
+    if (cursor == 0) {
+        result.total += get_carried(conf, *user_itr);
+    }
 
-        // check if the asset belongs to the user
-        if (asset_itr->owner != user) {
-            check(false, string("asset (" + to_string(asset_id) + ") does not belong to " + user.to_string()).c_str());
-        }
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
 
-        // find the asset data, to get the template id from it
-        const auto& aa_asset_itr = aa_asset_tbl.find(asset_id);
+    result.next = walk_assets(conf, user, cursor, limit, [&](const uint64_t& asset_id, const int32_t& template_id, const time_point_sec& last_claim) {
+        const auto& template_itr = template_tbl.find(uint64_t(template_id));
 
-        if (aa_asset_itr == aa_asset_tbl.end()) {
-            check(false, string("assert (" + to_string(asset_id) + ") does not exist").c_str());
-        }
+        pending_item item = { asset_id, asset(0, token_symbol(conf)), last_claim + min_claim_period(conf) };
 
-        // check if the asset's template is stakeable
-        const auto& template_itr = template_tbl.find(aa_asset_itr->template_id);
+        // the assets of removed templates can't be claimed
+        if (template_itr != template_tbl.end()) {
+            item.pending.amount = get_reward(*template_itr, last_claim, now);
+        }
 
-        if (template_itr == template_tbl.end()) {
-            check(false, string("asset (" + to_string(asset_id) + ") is not stakeable").c_str());
+        // claimall skips the assets in cooldown
+        if (now >= item.claimable_at) {
+            result.total += item.pending;
         }
 
-        auto period_sec = current_time_point().sec_since_epoch() - asset_itr->last_claim.sec_since_epoch();
+        result.assets.push_back(item);
+    });
 
-        // check if the asset can be unstaked
-        if (period_sec < config.unstake_period) {
-            check(false, string("asset (" + to_string(asset_id) + ") cannot be unstaked yet").c_str());
-        }
+    return result;
+}
 
-        // increment the removed amount
-        removed_rate += template_itr->hourly_rate;
+ezstake::stake_result ezstake::getstake(const name& user, const uint64_t& cursor, const uint32_t& limit)
+{
+    // check if the limit is valid
+    check(limit > 0, "limit must be positive");
 
-        // remove the assets from the user's staked assets
-        asset_tbl.erase(asset_itr);
-    }
+    // the staked assets can be read even while the contract is frozen
+    const auto& conf = read_config();
 
-    // sanity check
-    // this should never happen unless the template rate was changed after staking
-    check(removed_rate <= user_itr->hourly_rate, "unstaked rate larger than user's rate; this shouldn't happen !!");
+    stake_result result = {};
 
-    // save the new rate
-    user_tbl.modify(user_itr, same_payer, [&](auto& row) {
-        row.hourly_rate -= removed_rate;
+    result.next = walk_assets(conf, user, cursor, limit, [&](const uint64_t& asset_id, const int32_t& template_id, const time_point_sec& last_claim) {
+        result.assets.push_back(stake_item { asset_id, template_id, last_claim });
     });
 
-    // send the assets back
-    action(permission_level { get_self(), name("active") }, atomicassets::ATOMICASSETS_ACCOUNT, name("transfer"),
-        make_tuple(get_self(), user, asset_ids, string("Unstaking")))
-        .send();
+    return result;
+}
+
+ezstake::stats_s ezstake::getstats()
+{
+    return peek_stats(read_config());
 }
 
 [[eosio::on_notify("atomicassets::transfer")]] void
@@ -390,9 +1969,12 @@ ezstake::receiveassets(name from, name to, vector<uint64_t> asset_ids, string me
 
     // check if the user is registered
     if (user_itr == user_tbl.end()) {
-        check(false, string("user " + from.to_string() + " is not registered").c_str());
+        fail(USER_NOT_REGISTERED, 0, [&]() { return string("user " + from.to_string() + " is not registered"); });
     }
 
+    // check if the user isn't being reset
+    check_not_resetting(from);
+
     // get the assets table (scoped to the contract)
     const auto& aa_asset_tbl = atomicassets::get_assets(get_self());
 
@@ -401,36 +1983,80 @@ ezstake::receiveassets(name from, name to, vector<uint64_t> asset_ids, string me
     // get asset table instance
     asset_t asset_tbl(get_self(), get_self().value);
 
-    asset added_rate = asset(0, config.token_symbol);
+    asset added_rate = asset(0, token_symbol(config));
+    vector<pair<int32_t, int64_t>> tally = {};
+
+    const bool is_bucket = config.storage_mode.value_or(ROWS) == BUCKETS;
+    vector<bucket_entry> entries = {};
+
+    const time_point_sec now = current_time_point();
+    vector<cached_template> templates = {};
+
+    const vector<uint64_t> sorted_ids = sort_batch(asset_ids);
 
-    for (const uint64_t& asset_id : asset_ids) {
+    // the user's deposit pays for their new rows, the RAM they free is then refunded to them on unstake (user RAM mode)
+    const bool is_user_ram = !is_bucket && config.ram_mode.value_or(CONTRACT_RAM) == USER_RAM;
+    const name payer = is_user_ram ? from : get_self();
+
+    if (is_user_ram) {
+        use_deposit(from, sorted_ids.size());
+    }
+
+    for (const uint64_t& asset_id : sorted_ids) {
         // find the asset data, to get the template id from it
         const auto& aa_asset_itr = aa_asset_tbl.find(asset_id);
 
         if (aa_asset_itr == aa_asset_tbl.end()) {
-            check(false, string("assert (" + to_string(asset_id) + ") does not exist").c_str());
+            fail(ASSET_NOT_FOUND, asset_id, [&]() { return string("assert (" + to_string(asset_id) + ") does not exist"); });
         }
 
         // check if the asset's template is stakeable
-        const auto& template_itr = template_tbl.find(aa_asset_itr->template_id);
+        const cached_template* cached = find_cached(templates, template_tbl, aa_asset_itr->template_id);
+
+        // a template without a rate of its own gets one from the collection/schema rules on its first stake
+        if (cached == nullptr) {
+            cached = cache_rule_template(templates, template_tbl, *aa_asset_itr);
+        }
 
-        if (template_itr == template_tbl.end()) {
-            check(false, string("asset (" + to_string(asset_id) + ") is not stakeable").c_str());
+        if (cached == nullptr) {
+            fail(ASSET_NOT_STAKEABLE, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") is not stakeable"); });
         }
 
         // increment the added rate
-        added_rate += template_itr->hourly_rate;
+        added_rate += cached->row.hourly_rate;
+        tally_template(tally, aa_asset_itr->template_id, 1);
 
         // save the asset
-        asset_tbl.emplace(get_self(), [&](asset_s& row) {
-            row.asset_id = asset_id;
-            row.owner = from;
-            row.last_claim = time_point_sec(current_time_point());
-        });
+        if (is_bucket) {
+            entries.push_back(bucket_entry { asset_id, get_slot(aa_asset_itr->template_id), now.sec_since_epoch() });
+        } else {
+            asset_tbl.emplace(payer, [&](asset_s& row) {
+                row.asset_id = asset_id;
+                row.owner = from;
+                row.last_claim = now;
+                row.template_id = aa_asset_itr->template_id;
+                row.collection = aa_asset_itr->collection_name;
+            });
+        }
+    }
+
+    // pack the assets into the user's buckets
+    if (is_bucket) {
+        bucket_insert(from, entries);
     }
 
+    // apply the pending rate changes before adding to the counts
+    // only now, as adding a template from a rule can queue a rate change
+    rerate_user(config, user_tbl, user_itr);
+
+    update_counts(from, tally);
+    update_template_stats(tally);
+
     // save the new rate
-    user_tbl.modify(user_itr, same_payer, [&](auto& row) {
-        row.hourly_rate += added_rate;
-    });
+    change_rate(config, user_tbl, user_itr, added_rate, asset_ids.size());
+
+    // the sets completed by the new assets
+    update_boosts(config, user_tbl, user_itr, tally);
+
+    send_log(name("logstake"), from, asset_ids, added_rate, user_itr->hourly_rate);
 }
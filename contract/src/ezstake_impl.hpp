@@ -0,0 +1,1402 @@
+#pragma once
+
+// the helpers declared in ezstake.hpp, included by ezstake.cpp only
+// the header keeps the declarations, so the indexer can use the row definitions without the contract code
+
+#include <ezstake.hpp>
+
+ezstake::config ezstake::check_config()
+{
+    // get  current config
+    const auto& conf = read_config();
+
+    // check if contract isn't frozen
+    check(!conf.is_frozen, "smart contract is currently frozen");
+
+    return conf;
+}
+
+ezstake::config ezstake::read_config()
+{
+    // get config table
+    config_t conf_tbl(get_self(), get_self().value);
+
+#if FIXED_CONFIG
+    return conf_tbl.get_or_default(config {});
+#else
+    // check if a config exists
+    check(conf_tbl.exists(), "smart contract is not initialized yet");
+
+    return conf_tbl.get();
+#endif
+}
+
+template <typename Message>
+void ezstake::fail(const error_code_t& code, const uint64_t& id, Message&& message)
+{
+    if constexpr (VERBOSE_ERRORS) {
+        check(false, message());
+    } else {
+        check(false, (uint64_t(code) << 48) | (id & 0xFFFFFFFFFFFF));
+    }
+}
+
+void ezstake::check_not_resetting(const name& user)
+{
+    // get resets table instance
+    reset_t reset_tbl(get_self(), get_self().value);
+
+    if (reset_tbl.find(user.value) != reset_tbl.end()) {
+        fail(USER_RESETTING, 0, [&]() { return string("user " + user.to_string() + " is being reset"); });
+    }
+}
+
+int32_t ezstake::get_template_id(const asset_s& row)
+{
+    if (row.template_id.has_value()) {
+        return row.template_id.value();
+    }
+
+    // get the assets table (scoped to the contract)
+    const auto& aa_asset_tbl = atomicassets::get_assets(get_self());
+
+    const auto& aa_asset_itr = aa_asset_tbl.find(row.asset_id);
+
+    if (aa_asset_itr == aa_asset_tbl.end()) {
+        fail(ASSET_NOT_FOUND, row.asset_id, [&]() { return string("assert (" + to_string(row.asset_id) + ") does not exist"); });
+    }
+
+    return aa_asset_itr->template_id;
+}
+
+uint128_t ezstake::get_integral(const template_s& tmpl, const time_point_sec& t)
+{
+    // get epochs table instance
+    epoch_t epoch_tbl(get_self(), uint64_t(tmpl.template_id));
+
+    // the epoch with the latest start not after `t`
+    auto epoch_itr = epoch_tbl.upper_bound(t.sec_since_epoch());
+
+    if (epoch_itr == epoch_tbl.begin()) {
+        return uint128_t(tmpl.hourly_rate.amount) * t.sec_since_epoch();
+    }
+
+    epoch_itr--;
+
+    return epoch_integral(*epoch_itr, t);
+}
+
+int64_t ezstake::get_reward(const template_s& tmpl, const time_point_sec& from, const time_point_sec& to)
+{
+    const uint128_t reward = (get_integral(tmpl, to) - get_integral(tmpl, from)) / 3600;
+
+    check(reward <= uint128_t(asset::max_amount), "reward overflow");
+
+    return int64_t(reward);
+}
+
+void ezstake::add_epoch(const int32_t& template_id, const asset& old_rate, const asset& new_rate)
+{
+    // get epochs table instance
+    epoch_t epoch_tbl(get_self(), uint64_t(template_id));
+
+    const time_point_sec now = current_time_point();
+
+    if (epoch_tbl.begin() == epoch_tbl.end()) {
+        epoch_tbl.emplace(get_self(), [&](epoch_s& row) {
+            row.start = time_point_sec(0);
+            row.hourly_rate = old_rate;
+            row.integral = 0;
+        });
+    }
+
+    auto last_itr = epoch_tbl.end();
+    last_itr--;
+
+    // a second change in the same second replaces the rate of the epoch
+    if (last_itr->start == now) {
+        epoch_tbl.modify(last_itr, same_payer, [&](epoch_s& row) { row.hourly_rate = new_rate; });
+        return;
+    }
+
+    const uint128_t integral = epoch_integral(*last_itr, now);
+
+    epoch_tbl.emplace(get_self(), [&](epoch_s& row) {
+        row.start = now;
+        row.hourly_rate = new_rate;
+        row.integral = integral;
+    });
+}
+
+bool ezstake::has_epochs(const int32_t& template_id)
+{
+    // get epochs table instance
+    epoch_t epoch_tbl(get_self(), uint64_t(template_id));
+
+    return epoch_tbl.begin() != epoch_tbl.end();
+}
+
+void ezstake::set_template(template_t& template_tbl, const int32_t& template_id, const name& collection, const asset& hourly_rate, const bool& from_rule)
+{
+    const auto& template_row = template_tbl.find(uint64_t(template_id));
+
+    // the users still staking a re-added template were re-rated to a zero rate on its removal
+    const bool is_staked = has_counts(template_id);
+
+    // queue the rate change
+    if (is_staked && (template_row == template_tbl.end() || template_row->hourly_rate != hourly_rate)) {
+        queue_rerate(template_id);
+    }
+
+    // record the rate change in the template's history
+    // a brand-new template has no history, its assets are all staked from now on so its rate applies since the beginning
+    if (template_row == template_tbl.end()) {
+        if (has_epochs(template_id)) {
+            add_epoch(template_id, asset(0, hourly_rate.symbol), hourly_rate);
+        }
+    } else if (template_row->hourly_rate != hourly_rate) {
+        add_epoch(template_id, template_row->hourly_rate, hourly_rate);
+    }
+
+    // a rate of its own lifts the template's exclusion from the rules
+    if (!from_rule) {
+        // get exclusions table instance
+        exclusion_t exclusion_tbl(get_self(), collection.value);
+
+        const auto& exclusion_itr = exclusion_tbl.find(uint64_t(template_id));
+
+        if (exclusion_itr != exclusion_tbl.end()) {
+            exclusion_tbl.erase(exclusion_itr);
+        }
+    }
+
+    // insert the new template or update it if it already exists
+    if (template_row == template_tbl.end()) {
+        // a re-added template gets back the assets still staked since it was removed as their users are re-rated
+        template_tbl.emplace(get_self(), [&](template_s& row) {
+            row.template_id = template_id;
+            row.collection = collection;
+            row.hourly_rate = hourly_rate;
+            row.staked = 0;
+            row.from_rule = from_rule;
+        });
+    } else {
+        template_tbl.modify(template_row, get_self(), [&](template_s& row) {
+            row.template_id = template_id;
+            row.collection = collection;
+            row.hourly_rate = hourly_rate;
+
+            // only the rows added by a rule have the flag, and they always have the staked counter before it
+            if (row.from_rule.value_or(false) != from_rule) {
+                row.from_rule = from_rule;
+            }
+        });
+    }
+}
+
+void ezstake::queue_rerate(const int32_t& template_id)
+{
+    // get rerates table instance
+    rerate_t rerate_tbl(get_self(), get_self().value);
+
+    // a second change would leave the users already re-rated by an unfinished rerate behind
+    if (rerate_tbl.find(uint64_t(template_id)) != rerate_tbl.end()) {
+        fail(TEMPLATE_RERATING, template_id, [&]() { return string("template (" + to_string(template_id) + ") is still being re-rated"); });
+    }
+
+    rerate_tbl.emplace(get_self(), [&](rerate_s& row) { row.template_id = template_id; });
+}
+
+bool ezstake::is_rerated(const count_s& count, const template_s& tmpl)
+{
+    return count.hourly_rate == tmpl.hourly_rate && count.extra_rates.value_or() == tmpl.extra_rates.value_or();
+}
+
+void ezstake::remove_template(template_t& template_tbl, const template_t::const_iterator& template_row)
+{
+    const int32_t template_id = template_row->template_id;
+
+    add_epoch(template_id, template_row->hourly_rate, asset(0, template_row->hourly_rate.symbol));
+
+    if (has_counts(template_id)) {
+        queue_rerate(template_id);
+    }
+
+    template_tbl.erase(template_row);
+}
+
+bool ezstake::has_counts(const int32_t& template_id)
+{
+    // get counts table instance
+    count_t count_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto count_idx = count_tbl.get_index<name("templateuser")>();
+
+    const auto& count_itr = count_idx.lower_bound(template_user_key(template_id, name()));
+
+    return count_itr != count_idx.end() && count_itr->template_id == template_id;
+}
+
+ezstake::template_s ezstake::get_rerate_target(template_t& template_tbl, const int32_t& template_id, const symbol& token)
+{
+    const auto& template_itr = template_tbl.find(uint64_t(template_id));
+
+    if (template_itr != template_tbl.end()) {
+        return *template_itr;
+    }
+
+    template_s removed = {};
+    removed.template_id = template_id;
+    removed.hourly_rate = asset(0, token);
+
+    return removed;
+}
+
+std::optional<asset> ezstake::find_rule_rate(const name& collection, const name& schema)
+{
+    // get rules table instance
+    rule_t rule_tbl(get_self(), collection.value);
+
+    auto rule_itr = rule_tbl.find(schema.value);
+
+    if (rule_itr == rule_tbl.end()) {
+        rule_itr = rule_tbl.find(name().value);
+    }
+
+    if (rule_itr == rule_tbl.end()) {
+        return std::nullopt;
+    }
+
+    return rule_itr->hourly_rate;
+}
+
+bool ezstake::has_checkpoint(const config& conf, const user_s& user_row)
+{
+    if (conf.reward_mode.value_or(PER_ASSET) == PER_ASSET || !user_row.last_update.has_value()) {
+        return false;
+    }
+
+    return user_row.mode_switch.value_or(0) == conf.mode_switches.value_or(0);
+}
+
+asset ezstake::get_carried(const config& conf, const user_s& user_row)
+{
+    if (has_checkpoint(conf, user_row)) {
+        return asset(0, user_row.hourly_rate.symbol);
+    }
+
+    return user_row.accrued.value_or(asset(0, user_row.hourly_rate.symbol));
+}
+
+asset ezstake::get_accrued(const config& conf, const user_s& user_row, const time_point_sec& now)
+{
+    if (has_checkpoint(conf, user_row)) {
+        return get_checkpoint_accrued(user_row, now);
+    }
+
+    asset accrued = get_carried(conf, user_row);
+
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+    // get asset table instance
+    asset_t asset_tbl(get_self(), get_self().value);
+
+    with_owner_index(conf, asset_tbl, user_row.user, 0, [&](auto& owner_idx, auto owner_itr) {
+        for (; owner_itr != owner_idx.end() && owner_itr->owner == user_row.user; owner_itr++) {
+            const auto& template_itr = template_tbl.find(get_template_id(*owner_itr));
+
+            // skip the removed templates, they can't be claimed in per-asset mode either
+            if (template_itr == template_tbl.end()) {
+                continue;
+            }
+
+            accrued.amount += get_reward(*template_itr, owner_itr->last_claim, now);
+        }
+    });
+
+    // the assets packed into buckets keep their last claim as their time
+    bucket_walk(user_row.user, 0, UINT32_MAX, [&](const bucket_entry& entry) {
+        const auto& template_itr = template_tbl.find(get_slot_template(entry.slot));
+
+        if (template_itr != template_tbl.end()) {
+            accrued.amount += get_reward(*template_itr, time_point_sec(entry.time), now);
+        }
+
+        return false;
+    });
+
+    return accrued;
+}
+
+void ezstake::send_unstaked(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr, const asset& removed_rate, const vector<pair<int32_t, int64_t>>& tally, const vector<uint64_t>& asset_ids, const int64_t& forfeited)
+{
+    // sanity check
+    // this should never happen unless the template rate was changed after staking
+    check(removed_rate <= user_itr->hourly_rate, "unstaked rate larger than user's rate; this shouldn't happen !!");
+
+    // save the new rate
+    change_rate(conf, user_tbl, user_itr, -removed_rate, -int64_t(asset_ids.size()));
+    update_counts(user_itr->user, tally);
+    update_boosts(conf, user_tbl, user_itr, tally);
+    update_template_stats(tally);
+
+    if (forfeited > 0) {
+        update_stats(conf, [&](stats_s& row) { release_liability(row, forfeited); });
+    }
+
+    // send the assets back
+    action(permission_level { get_self(), name("active") }, atomicassets::ATOMICASSETS_ACCOUNT, name("transfer"),
+        make_tuple(get_self(), user_itr->user, asset_ids, string("Unstaking")))
+        .send();
+
+    send_log(name("logunstake"), user_itr->user, asset_ids, removed_rate, user_itr->hourly_rate);
+}
+
+asset ezstake::settle_user(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr, const pool_s& pool, const time_point_sec& now)
+{
+    const bool is_pool = conf.reward_mode.value_or(PER_ASSET) == POOL;
+    const asset accrued = is_pool ? get_pool_accrued(*user_itr, pool) : get_accrued(conf, *user_itr, now);
+
+    // reset the user's checkpoint
+    user_tbl.modify(user_itr, same_payer, [&](auto& row) {
+        set_checkpoint(conf, row, asset(0, token_symbol(conf)), now);
+        row.last_claim = now;
+
+        if (is_pool) {
+            row.reward_debt = muldiv(row.hourly_rate.amount, pool.acc_reward_per_power, REWARD_PRECISION);
+        }
+    });
+
+    return accrued;
+}
+
+void ezstake::send_log(const name& log_action, const name& user, const vector<uint64_t>& asset_ids, const asset& amount, const asset& hourly_rate)
+{
+    const uint64_t total_power = stats_t(get_self(), get_self().value).get_or_default().total_power;
+
+    action(permission_level { get_self(), name("active") }, get_self(), log_action,
+        make_tuple(user, asset_ids, amount, hourly_rate, total_power))
+        .send();
+}
+
+void ezstake::change_rate(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr, const asset& delta, const int64_t& staked_delta)
+{
+    const time_point_sec now = current_time_point();
+
+    update_stats(conf, [&](stats_s& row) {
+        add_saturated(row.total_power, delta.amount);
+        add_saturated(row.staked_assets, staked_delta);
+        update_leaderboard(row, user_itr->user, user_itr->hourly_rate.amount + delta.amount);
+    });
+
+    if (conf.reward_mode.value_or(PER_ASSET) == POOL) {
+        // settle the pool with the old total power
+        const pool_s pool = update_pool(conf, delta.amount);
+
+        // get the rewards accrued with the old rate
+        const asset accrued = get_pool_accrued(*user_itr, pool);
+
+        user_tbl.modify(user_itr, same_payer, [&](auto& row) {
+            set_checkpoint(conf, row, accrued, now);
+
+            row.hourly_rate += delta;
+            row.reward_debt = muldiv(row.hourly_rate.amount, pool.acc_reward_per_power, REWARD_PRECISION);
+        });
+
+        return;
+    }
+    const bool is_accrual = conf.reward_mode.value_or(PER_ASSET) == ACCRUAL;
+
+    // get the rewards accrued with the old rate
+    const asset accrued = is_accrual ? get_accrued(conf, *user_itr, now) : asset(0, token_symbol(conf));
+
+    // save the new rate
+    user_tbl.modify(user_itr, same_payer, [&](auto& row) {
+        if (is_accrual) {
+            set_checkpoint(conf, row, accrued, now);
+        }
+
+        row.hourly_rate += delta;
+    });
+}
+
+void ezstake::tally_template(vector<pair<int32_t, int64_t>>& tally, const int32_t& template_id, const int64_t& delta)
+{
+    for (auto& item : tally) {
+        if (item.first == template_id) {
+            item.second += delta;
+            return;
+        }
+    }
+
+    tally.push_back({ template_id, delta });
+}
+
+vector<uint64_t> ezstake::sort_batch(const vector<uint64_t>& asset_ids)
+{
+    vector<uint64_t> sorted = asset_ids;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    const auto& duplicate_itr = std::adjacent_find(sorted.begin(), sorted.end());
+
+    if (duplicate_itr != sorted.end()) {
+        fail(ASSET_DUPLICATED, *duplicate_itr, [&]() { return string("asset (" + to_string(*duplicate_itr) + ") is listed more than once"); });
+    }
+
+    return sorted;
+}
+
+ezstake::cached_template* ezstake::find_cached(vector<cached_template>& cache, template_t& template_tbl, const int32_t& template_id)
+{
+    for (auto& item : cache) {
+        if (item.template_id == template_id) {
+            return item.is_stakeable ? &item : nullptr;
+        }
+    }
+
+    const auto& template_itr = template_tbl.find(uint64_t(template_id));
+    const bool is_stakeable = template_itr != template_tbl.end();
+
+    cache.push_back({ template_id, is_stakeable, is_stakeable ? *template_itr : template_s {}, std::nullopt });
+
+    return is_stakeable ? &cache.back() : nullptr;
+}
+
+ezstake::cached_template* ezstake::cache_rule_template(vector<cached_template>& cache, template_t& template_tbl, const atomicassets::assets_s& aa_asset)
+{
+    // get exclusions table instance
+    exclusion_t exclusion_tbl(get_self(), aa_asset.collection_name.value);
+
+    // the templates removed by rmtemplates stay out of the rules
+    if (exclusion_tbl.find(uint64_t(aa_asset.template_id)) != exclusion_tbl.end()) {
+        return nullptr;
+    }
+
+    const std::optional<asset> hourly_rate = find_rule_rate(aa_asset.collection_name, aa_asset.schema_name);
+
+    if (!hourly_rate.has_value()) {
+        return nullptr;
+    }
+
+    set_template(template_tbl, aa_asset.template_id, aa_asset.collection_name, hourly_rate.value(), true);
+
+    // the failed lookup was cached, replace it
+    for (auto& item : cache) {
+        if (item.template_id == aa_asset.template_id) {
+            item.is_stakeable = true;
+            item.row = *template_tbl.find(uint64_t(aa_asset.template_id));
+
+            return &item;
+        }
+    }
+
+    return nullptr;
+}
+
+int64_t ezstake::get_cached_reward(cached_template& cached, const time_point_sec& from, const time_point_sec& to)
+{
+    if (!cached.integral.has_value()) {
+        cached.integral = get_integral(cached.row, to);
+    }
+
+    const uint128_t reward = (cached.integral.value() - get_integral(cached.row, from)) / 3600;
+
+    check(reward <= uint128_t(asset::max_amount), "reward overflow");
+
+    return int64_t(reward);
+}
+
+void ezstake::update_counts(const name& user, const vector<pair<int32_t, int64_t>>& tally)
+{
+    // get counts table instance
+    count_t count_tbl(get_self(), get_self().value);
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto count_idx = count_tbl.get_index<name("usertemplate")>();
+
+    // the extra rates the user gains or loses
+    vector<extended_asset> extra_delta = {};
+
+    for (const auto& [template_id, delta] : tally) {
+        const auto& count_itr = count_idx.find(owner_asset_key(user, uint64_t(template_id)));
+
+        if (count_itr != count_idx.end()) {
+            // the user's extra rates include the counted assets at the count's rates
+            // the legacy assets unstaked with them were never counted, they only take out the counted ones
+            add_rates(extra_delta, count_itr->extra_rates.value_or(), std::max(delta, -int64_t(count_itr->count)));
+
+            if (int64_t(count_itr->count) + delta <= 0) {
+                count_idx.erase(count_itr);
+            } else {
+                count_idx.modify(count_itr, same_payer, [&](count_s& row) { row.count += delta; });
+            }
+
+            continue;
+        }
+
+        const auto& template_itr = template_tbl.find(uint64_t(template_id));
+
+        // the assets staked before the counts were kept have no row to decrement
+        // and the assets of removed templates have no rate to record
+        if (delta <= 0 || template_itr == template_tbl.end()) {
+            continue;
+        }
+
+        const vector<extended_asset> extra_rates = template_itr->extra_rates.value_or();
+
+        add_rates(extra_delta, extra_rates, delta);
+
+        count_tbl.emplace(get_self(), [&](count_s& row) {
+            row.id = count_tbl.available_primary_key();
+            row.user = user;
+            row.template_id = template_id;
+            row.count = delta;
+            row.hourly_rate = template_itr->hourly_rate;
+
+            // the counts of the single token templates keep their size
+            if (!extra_rates.empty()) {
+                row.extra_rates = extra_rates;
+            }
+        });
+    }
+
+    change_extra_rates(user, extra_delta);
+}
+
+void ezstake::update_template_stats(const vector<pair<int32_t, int64_t>>& tally)
+{
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+
+    for (const auto& [template_id, delta] : tally) {
+        const auto& template_itr = template_tbl.find(uint64_t(template_id));
+
+        // the removed templates have no counter
+        if (template_itr == template_tbl.end()) {
+            continue;
+        }
+
+        template_tbl.modify(template_itr, same_payer, [&](template_s& row) {
+            uint64_t staked = row.staked.value_or(0);
+
+            add_saturated(staked, delta);
+
+            row.staked = staked;
+        });
+    }
+}
+
+ezstake::stats_s ezstake::peek_stats(const config& conf)
+{
+    // get stats table instance
+    stats_t stats_tbl(get_self(), get_self().value);
+
+    stats_s stats = stats_tbl.get_or_default(stats_s {});
+
+    const time_point_sec now = current_time_point();
+
+    if (stats.total_power > 0 && now > stats.last_update) {
+        // the pool emits a fixed amount as long as something is staked
+        const uint64_t hourly_rate = conf.reward_mode.value_or(PER_ASSET) == POOL ? conf.hourly_emission.value_or().amount : stats.total_power;
+
+        stats.liability += uint128_t(hourly_rate) * (now.sec_since_epoch() - stats.last_update.sec_since_epoch());
+    }
+
+    stats.last_update = now;
+
+    return stats;
+}
+
+template <typename Lambda>
+void ezstake::update_stats(const config& conf, Lambda&& updater)
+{
+    // get stats table instance
+    stats_t stats_tbl(get_self(), get_self().value);
+
+    stats_s stats = peek_stats(conf);
+
+    updater(stats);
+
+    stats_tbl.set(stats, get_self());
+}
+
+void ezstake::add_saturated(uint64_t& value, const int64_t& delta)
+{
+    value = delta < 0 && value < uint64_t(-delta) ? 0 : value + delta;
+}
+
+#if LEADERBOARD_SIZE > 0
+void ezstake::update_leaderboard(stats_s& stats, const name& user, const uint64_t& hourly_rate)
+{
+    // get leaders table instance
+    leader_t leader_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto rate_idx = leader_tbl.get_index<name("rate")>();
+
+    const auto& leader_itr = leader_tbl.find(user.value);
+
+    uint32_t leaders = stats.leaders.value_or(0);
+
+    if (leader_itr != leader_tbl.end()) {
+        bool is_dropped = hourly_rate == 0;
+
+        if (!is_dropped && leaders >= LEADERBOARD_SIZE && hourly_rate < leader_itr->hourly_rate) {
+            auto lowest_itr = rate_idx.begin();
+
+            // the lowest of the other leaders
+            if (lowest_itr->user == user) {
+                lowest_itr++;
+            }
+
+            is_dropped = lowest_itr == rate_idx.end() || hourly_rate < lowest_itr->hourly_rate;
+        }
+
+        if (is_dropped) {
+            leader_tbl.erase(leader_itr);
+            stats.leaders = leaders - 1;
+        } else if (leader_itr->hourly_rate != hourly_rate) {
+            leader_tbl.modify(leader_itr, same_payer, [&](leader_s& row) { row.hourly_rate = hourly_rate; });
+        }
+
+        return;
+    }
+
+    if (hourly_rate == 0) {
+        return;
+    }
+
+    if (leaders >= LEADERBOARD_SIZE) {
+        const auto& lowest_itr = rate_idx.begin();
+
+        // the user doesn't make it to the leaderboard
+        if (lowest_itr->hourly_rate >= hourly_rate) {
+            return;
+        }
+
+        rate_idx.erase(lowest_itr);
+        leaders--;
+    }
+
+    leader_tbl.emplace(get_self(), [&](leader_s& row) {
+        row.user = user;
+        row.hourly_rate = hourly_rate;
+    });
+
+    stats.leaders = leaders + 1;
+}
+#else
+void ezstake::update_leaderboard(stats_s&, const name&, const uint64_t&) { }
+#endif
+
+void ezstake::release_liability(stats_s& stats, const int64_t& amount)
+{
+    const uint128_t released = uint128_t(amount) * 3600;
+
+    stats.liability = stats.liability > released ? stats.liability - released : 0;
+}
+
+int64_t ezstake::get_asset_reward(const int32_t& template_id, const time_point_sec& from, const time_point_sec& to)
+{
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+
+    const auto& template_itr = template_tbl.find(uint64_t(template_id));
+
+    return template_itr == template_tbl.end() ? 0 : get_reward(*template_itr, from, to);
+}
+
+void ezstake::erase_counts(const name& user)
+{
+    // get counts table instance
+    count_t count_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto count_idx = count_tbl.get_index<name("usertemplate")>();
+    auto count_itr = count_idx.lower_bound(owner_asset_key(user, 0));
+
+    vector<pair<int32_t, int64_t>> readded = {};
+
+    while (count_itr != count_idx.end() && count_itr->user == user) {
+        // only the counts re-rated on a removal have a zero rate
+        if (count_itr->hourly_rate.amount == 0) {
+            tally_template(readded, count_itr->template_id, int64_t(count_itr->count));
+        }
+
+        count_itr = count_idx.erase(count_itr);
+    }
+
+    // the templates still removed have no counter
+    update_template_stats(readded);
+}
+
+void ezstake::rerate_user(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr)
+{
+    // get rerates table instance
+    rerate_t rerate_tbl(get_self(), get_self().value);
+
+    if (rerate_tbl.begin() == rerate_tbl.end()) {
+        return;
+    }
+
+    // get counts table instance
+    count_t count_tbl(get_self(), get_self().value);
+    // get template table instance
+    template_t template_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto count_idx = count_tbl.get_index<name("usertemplate")>();
+
+    asset delta = asset(0, token_symbol(conf));
+    vector<extended_asset> extra_delta = {};
+    vector<pair<int32_t, int64_t>> rerated = {};
+    vector<pair<int32_t, int64_t>> readded = {};
+
+    for (const rerate_s& rerate : rerate_tbl) {
+        const auto& count_itr = count_idx.find(owner_asset_key(user_itr->user, uint64_t(rerate.template_id)));
+
+        // skip the templates the user isn't staking
+        if (count_itr == count_idx.end()) {
+            continue;
+        }
+
+        // the users of a removed template are moved to a zero rate
+        const template_s target = get_rerate_target(template_tbl, rerate.template_id, token_symbol(conf));
+
+        // skip the ones already re-rated
+        if (is_rerated(*count_itr, target)) {
+            continue;
+        }
+
+        delta.amount += int64_t(count_itr->count) * (target.hourly_rate.amount - count_itr->hourly_rate.amount);
+        add_rates(extra_delta, target.extra_rates.value_or(), int64_t(count_itr->count));
+        add_rates(extra_delta, count_itr->extra_rates.value_or(), -int64_t(count_itr->count));
+
+        // the assets of a re-added template go back into its staked counter
+        if (count_itr->hourly_rate.amount == 0) {
+            tally_template(readded, rerate.template_id, int64_t(count_itr->count));
+        }
+
+        count_idx.modify(count_itr, same_payer, [&](count_s& row) {
+            row.hourly_rate = target.hourly_rate;
+            row.extra_rates = target.extra_rates.value_or();
+        });
+
+        tally_template(rerated, rerate.template_id, 0);
+    }
+
+    if (delta.amount != 0) {
+        change_rate(conf, user_tbl, user_itr, delta);
+    }
+
+    change_extra_rates(user_itr->user, extra_delta);
+    update_template_stats(readded);
+
+    // the boosts follow the counts' new rates
+    update_boosts(conf, user_tbl, user_itr, rerated);
+}
+
+void ezstake::update_boosts(const config& conf, user_t& user_tbl, const user_t::const_iterator& user_itr, const vector<pair<int32_t, int64_t>>& tally)
+{
+    // the per-asset rewards don't use the user's rate
+    if (conf.reward_mode.value_or(PER_ASSET) == PER_ASSET) {
+        return;
+    }
+
+    vector<uint64_t> set_ids = {};
+
+    // find the sets of the templates
+    for (const auto& [template_id, delta] : tally) {
+        // get set links table instance
+        setlink_t setlink_tbl(get_self(), uint64_t(template_id));
+
+        for (const setlink_s& link : setlink_tbl) {
+            if (std::find(set_ids.begin(), set_ids.end(), link.set_id) == set_ids.end()) {
+                set_ids.push_back(link.set_id);
+            }
+        }
+    }
+
+    if (set_ids.empty()) {
+        return;
+    }
+
+    // get sets table instance
+    set_t set_tbl(get_self(), get_self().value);
+    // get boosts table instance
+    boost_t boost_tbl(get_self(), get_self().value);
+    // get counts table instance
+    count_t count_tbl(get_self(), get_self().value);
+
+    // get the secondary indexes
+    auto boost_idx = boost_tbl.get_index<name("userset")>();
+    auto count_idx = count_tbl.get_index<name("usertemplate")>();
+
+    asset delta = asset(0, token_symbol(conf));
+
+    for (const uint64_t& set_id : set_ids) {
+        const set_s& set = set_tbl.get(set_id, "set does not exist");
+
+        // the number of complete sets is the lowest count of its templates
+        uint64_t complete = UINT64_MAX;
+        int64_t set_rate = 0;
+
+        for (const int32_t& template_id : set.template_ids) {
+            const auto& count_itr = count_idx.find(owner_asset_key(user_itr->user, uint64_t(template_id)));
+
+            if (count_itr == count_idx.end()) {
+                complete = 0;
+                break;
+            }
+
+            complete = std::min(complete, count_itr->count);
+            set_rate += count_itr->hourly_rate.amount;
+        }
+
+        const int64_t bonus = complete == 0 ? 0 : int64_t(int128_t(set_rate) * complete * set.boost / 10000);
+        const auto& boost_itr = boost_idx.find(owner_asset_key(user_itr->user, set_id));
+
+        if (boost_itr == boost_idx.end()) {
+            if (complete > 0) {
+                boost_tbl.emplace(get_self(), [&](boost_s& row) {
+                    row.id = boost_tbl.available_primary_key();
+                    row.user = user_itr->user;
+                    row.set_id = set_id;
+                    row.complete = complete;
+                    row.bonus_rate = asset(bonus, token_symbol(conf));
+                });
+
+                delta.amount += bonus;
+            }
+
+            continue;
+        }
+
+        delta.amount += bonus - boost_itr->bonus_rate.amount;
+
+        if (complete == 0) {
+            boost_idx.erase(boost_itr);
+        } else if (boost_itr->complete != complete || boost_itr->bonus_rate.amount != bonus) {
+            boost_idx.modify(boost_itr, same_payer, [&](boost_s& row) {
+                row.complete = complete;
+                row.bonus_rate.amount = bonus;
+            });
+        }
+    }
+
+    if (delta.amount != 0) {
+        change_rate(conf, user_tbl, user_itr, delta);
+    }
+}
+
+void ezstake::erase_boosts(const name& user)
+{
+    // get boosts table instance
+    boost_t boost_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto boost_idx = boost_tbl.get_index<name("userset")>();
+    auto boost_itr = boost_idx.lower_bound(owner_asset_key(user, 0));
+
+    while (boost_itr != boost_idx.end() && boost_itr->user == user) {
+        boost_itr = boost_idx.erase(boost_itr);
+    }
+}
+
+ezstake::pool_s ezstake::peek_pool(const config& conf)
+{
+    // get pool table instance
+    pool_t pool_tbl(get_self(), get_self().value);
+
+    return advance_pool(conf, pool_tbl.get_or_default(pool_s {}), current_time_point());
+}
+
+ezstake::pool_s ezstake::update_pool(const config& conf, const int64_t& power_delta)
+{
+    // get pool table instance
+    pool_t pool_tbl(get_self(), get_self().value);
+
+    pool_s pool = peek_pool(conf);
+
+    check(power_delta >= 0 || pool.total_power >= uint64_t(-power_delta), "pool power underflow; this shouldn't happen !!");
+
+    pool.total_power += power_delta;
+
+    pool_tbl.set(pool, get_self());
+
+    return pool;
+}
+
+void ezstake::set_checkpoint(const config& conf, user_s& row, const asset& accrued, const time_point_sec& now)
+{
+    row.accrued = accrued;
+    row.last_update = now;
+    row.last_claim = row.last_claim.value_or();
+
+    // the extensions before mode_switch must be set for it to be serialized
+    row.reward_debt = row.reward_debt.value_or(0);
+    row.mode_switch = conf.mode_switches.value_or(0);
+}
+
+asset ezstake::take_carried(user_t& user_tbl, const user_t::const_iterator& user_itr)
+{
+    const asset carried = user_itr->accrued.value_or(asset(0, user_itr->hourly_rate.symbol));
+
+    if (carried.amount > 0) {
+        user_tbl.modify(user_itr, same_payer, [&](auto& row) { row.accrued = asset(0, carried.symbol); });
+    }
+
+    return carried;
+}
+
+void ezstake::add_rates(vector<extended_asset>& rates, const vector<extended_asset>& delta, const int64_t& times)
+{
+    for (const extended_asset& item : delta) {
+        const auto& rate_itr = std::find_if(rates.begin(), rates.end(), [&](const extended_asset& rate) { return rate.get_extended_symbol() == item.get_extended_symbol(); });
+
+        if (rate_itr == rates.end()) {
+            rates.push_back(extended_asset(asset(item.quantity.amount * times, item.quantity.symbol), item.contract));
+        } else {
+            rate_itr->quantity.amount += item.quantity.amount * times;
+        }
+    }
+
+    rates.erase(std::remove_if(rates.begin(), rates.end(), [](const extended_asset& rate) { return rate.quantity.amount == 0; }), rates.end());
+}
+
+void ezstake::accrue_extras(reward_s& row, const time_point_sec& now)
+{
+    const uint32_t elapsed = now.sec_since_epoch() - row.last_update.sec_since_epoch();
+
+    for (const extended_asset& rate : row.hourly_rates) {
+        const int64_t amount = int64_t((int128_t(rate.quantity.amount) * elapsed) / 3600);
+
+        add_rates(row.accrued, { extended_asset(asset(amount, rate.quantity.symbol), rate.contract) }, 1);
+    }
+
+    row.last_update = now;
+}
+
+void ezstake::change_extra_rates(const name& user, const vector<extended_asset>& delta)
+{
+    if (delta.empty()) {
+        return;
+    }
+
+    // get rewards table instance
+    reward_t reward_tbl(get_self(), get_self().value);
+
+    const auto& reward_itr = reward_tbl.find(user.value);
+    const time_point_sec now = current_time_point();
+
+    reward_s reward = reward_itr != reward_tbl.end() ? *reward_itr : reward_s { user, {}, {}, now, time_point_sec(0) };
+
+    accrue_extras(reward, now);
+    add_rates(reward.hourly_rates, delta, 1);
+
+    for (const extended_asset& rate : reward.hourly_rates) {
+        check(rate.quantity.amount > 0, "extra rate underflow; this shouldn't happen !!");
+    }
+
+    save_extras(reward_tbl, reward_itr, reward);
+}
+
+void ezstake::save_extras(reward_t& reward_tbl, const reward_t::const_iterator& reward_itr, const reward_s& reward)
+{
+    const bool is_empty = reward.hourly_rates.empty() && reward.accrued.empty();
+
+    if (reward_itr == reward_tbl.end()) {
+        if (!is_empty) {
+            reward_tbl.emplace(get_self(), [&](reward_s& row) { row = reward; });
+        }
+    } else if (is_empty) {
+        reward_tbl.erase(reward_itr);
+    } else {
+        reward_tbl.modify(reward_itr, same_payer, [&](reward_s& row) { row = reward; });
+    }
+}
+
+vector<extended_asset> ezstake::get_extras_accrued(const name& user, const time_point_sec& now)
+{
+    // get rewards table instance
+    reward_t reward_tbl(get_self(), get_self().value);
+
+    const auto& reward_itr = reward_tbl.find(user.value);
+
+    if (reward_itr == reward_tbl.end()) {
+        return {};
+    }
+
+    reward_s reward = *reward_itr;
+
+    accrue_extras(reward, now);
+
+    return reward.accrued;
+}
+
+bool ezstake::pay_extras(const config& conf, const name& user, const time_point_sec& now)
+{
+    // get rewards table instance
+    reward_t reward_tbl(get_self(), get_self().value);
+
+    const auto& reward_itr = reward_tbl.find(user.value);
+
+    if (reward_itr == reward_tbl.end() || now.sec_since_epoch() - reward_itr->last_claim.sec_since_epoch() < min_claim_period(conf)) {
+        return false;
+    }
+
+    reward_s reward = *reward_itr;
+
+    accrue_extras(reward, now);
+
+    if (reward.accrued.empty()) {
+        return false;
+    }
+
+    // send the tokens
+    for (const extended_asset& amount : reward.accrued) {
+        action(permission_level { get_self(), name("active") }, amount.contract, name("transfer"),
+            make_tuple(get_self(), user, amount.quantity, string("Staking reward")))
+            .send();
+    }
+
+    reward.accrued.clear();
+    reward.last_claim = now;
+
+    save_extras(reward_tbl, reward_itr, reward);
+
+    return true;
+}
+
+void ezstake::clear_extra_rates(const name& user)
+{
+    // get rewards table instance
+    reward_t reward_tbl(get_self(), get_self().value);
+
+    const auto& reward_itr = reward_tbl.find(user.value);
+
+    if (reward_itr == reward_tbl.end()) {
+        return;
+    }
+
+    reward_s reward = *reward_itr;
+
+    accrue_extras(reward, current_time_point());
+    reward.hourly_rates.clear();
+
+    save_extras(reward_tbl, reward_itr, reward);
+}
+
+void ezstake::erase_extras(const name& user)
+{
+    // get rewards table instance
+    reward_t reward_tbl(get_self(), get_self().value);
+
+    const auto& reward_itr = reward_tbl.find(user.value);
+
+    if (reward_itr != reward_tbl.end()) {
+        reward_tbl.erase(reward_itr);
+    }
+}
+
+bool ezstake::has_staked_assets()
+{
+    // get asset table instance
+    asset_t asset_tbl(get_self(), get_self().value);
+    // get buckets table instance
+    bucket_t bucket_tbl(get_self(), get_self().value);
+
+    return asset_tbl.begin() != asset_tbl.end() || bucket_tbl.begin() != bucket_tbl.end();
+}
+
+void ezstake::use_deposit(const name& user, const uint64_t& count)
+{
+    // get deposits table instance
+    ramdeposit_t deposit_tbl(get_self(), get_self().value);
+
+    const auto& deposit_itr = deposit_tbl.find(user.value);
+    const uint64_t required = count * ASSET_ROW_RAM;
+
+    // check if the deposit covers the new rows
+    if (deposit_itr == deposit_tbl.end() || deposit_itr->reserved.size() < required) {
+        fail(RAM_NOT_DEPOSITED, required, [&]() { return string("user " + user.to_string() + " has not deposited enough RAM, " + to_string(required) + " bytes required"); });
+    }
+
+    deposit_tbl.modify(deposit_itr, same_payer, [&](ramdeposit_s& row) { row.reserved.resize(row.reserved.size() - required); });
+}
+
+uint16_t ezstake::get_slot(const int32_t& template_id)
+{
+    // get slots table instance
+    slot_t slot_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto template_idx = slot_tbl.get_index<name("template")>();
+
+    const auto& slot_itr = template_idx.find(uint64_t(template_id));
+
+    if (slot_itr != template_idx.end()) {
+        return uint16_t(slot_itr->slot);
+    }
+
+    const uint64_t slot = slot_tbl.available_primary_key();
+
+    check(slot <= UINT16_MAX, "no template slots left");
+
+    slot_tbl.emplace(get_self(), [&](slot_s& row) {
+        row.slot = slot;
+        row.template_id = template_id;
+    });
+
+    return uint16_t(slot);
+}
+
+int32_t ezstake::get_slot_template(const uint16_t& slot)
+{
+    // get slots table instance
+    slot_t slot_tbl(get_self(), get_self().value);
+
+    return slot_tbl.get(slot, "template slot does not exist").template_id;
+}
+
+template <typename Index>
+auto ezstake::find_bucket(const Index& bucket_idx, const name& user, const uint64_t& asset_id)
+{
+    // the bucket with the highest lo_id not greater than the asset_id
+    auto bucket_itr = bucket_idx.upper_bound(owner_asset_key(user, asset_id));
+
+    if (bucket_itr == bucket_idx.begin()) {
+        return bucket_idx.end();
+    }
+
+    bucket_itr--;
+
+    if (bucket_itr->owner != user) {
+        return bucket_idx.end();
+    }
+
+    return bucket_itr;
+}
+
+void ezstake::save_bucket(bucket_t& bucket_tbl, const bucket_s* bucket, const name& user, const uint64_t& lo_id, const vector<bucket_entry>& entries)
+{
+    if (entries.empty()) {
+        if (bucket != nullptr) {
+            bucket_tbl.erase(*bucket);
+        }
+
+        return;
+    }
+
+    const size_t count = (entries.size() + BUCKET_CAPACITY - 1) / BUCKET_CAPACITY;
+
+    for (size_t i = 0; i < count; i++) {
+        const auto first = entries.begin() + entries.size() * i / count;
+        const auto last = entries.begin() + entries.size() * (i + 1) / count;
+
+        // the first part keeps the range's lo_id, the others start at their first asset
+        if (i == 0 && bucket != nullptr) {
+            bucket_tbl.modify(*bucket, same_payer, [&](bucket_s& row) { row.entries.assign(first, last); });
+        } else {
+            bucket_tbl.emplace(get_self(), [&](bucket_s& row) {
+                row.id = bucket_tbl.available_primary_key();
+                row.owner = user;
+                row.lo_id = i == 0 ? lo_id : first->asset_id;
+                row.entries.assign(first, last);
+            });
+        }
+    }
+}
+
+void ezstake::bucket_insert(const name& user, vector<bucket_entry> entries)
+{
+    // get buckets table instance
+    bucket_t bucket_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto bucket_idx = bucket_tbl.get_index<name("ownerrange")>();
+
+    const auto by_asset_id = [](const bucket_entry& a, const bucket_entry& b) { return a.asset_id < b.asset_id; };
+
+    std::sort(entries.begin(), entries.end(), by_asset_id);
+
+    for (size_t i = 0; i < entries.size();) {
+        const auto& bucket_itr = find_bucket(bucket_idx, user, entries[i].asset_id);
+        const bool is_new = bucket_itr == bucket_idx.end();
+
+        // the range ends where the user's next bucket starts
+        auto next_itr = bucket_itr;
+
+        if (is_new) {
+            next_itr = bucket_idx.lower_bound(owner_asset_key(user, 0));
+        } else {
+            next_itr++;
+        }
+
+        const uint64_t hi_id = next_itr != bucket_idx.end() && next_itr->owner == user ? next_itr->lo_id : UINT64_MAX;
+
+        vector<bucket_entry> merged = is_new ? vector<bucket_entry> {} : bucket_itr->entries;
+        const size_t middle = merged.size();
+
+        while (i < entries.size() && entries[i].asset_id < hi_id) {
+            merged.push_back(entries[i++]);
+        }
+
+        std::inplace_merge(merged.begin(), merged.begin() + middle, merged.end(), by_asset_id);
+
+        save_bucket(bucket_tbl, is_new ? nullptr : &*bucket_itr, user, is_new ? 0 : bucket_itr->lo_id, merged);
+    }
+}
+
+vector<ezstake::bucket_entry> ezstake::bucket_remove(const name& user, vector<uint64_t> asset_ids)
+{
+    // get buckets table instance
+    bucket_t bucket_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto bucket_idx = bucket_tbl.get_index<name("ownerrange")>();
+
+    vector<bucket_entry> removed = {};
+
+    std::sort(asset_ids.begin(), asset_ids.end());
+
+    for (size_t i = 0; i < asset_ids.size();) {
+        const auto& bucket_itr = find_bucket(bucket_idx, user, asset_ids[i]);
+
+        if (bucket_itr == bucket_idx.end()) {
+            fail(ASSET_NOT_STAKED, asset_ids[i], [&]() { return string("asset (" + to_string(asset_ids[i]) + ") is not staked"); });
+        }
+
+        // the range ends where the user's next bucket starts
+        auto next_itr = bucket_itr;
+        next_itr++;
+
+        const uint64_t hi_id = next_itr != bucket_idx.end() && next_itr->owner == user ? next_itr->lo_id : UINT64_MAX;
+
+        vector<bucket_entry> entries = bucket_itr->entries;
+
+        while (i < asset_ids.size() && asset_ids[i] < hi_id) {
+            const uint64_t asset_id = asset_ids[i++];
+
+            // binary search the asset in the bucket
+            const auto entry_itr = std::lower_bound(entries.begin(), entries.end(), asset_id,
+                [](const bucket_entry& entry, const uint64_t& id) { return entry.asset_id < id; });
+
+            if (entry_itr == entries.end() || entry_itr->asset_id != asset_id) {
+                fail(ASSET_NOT_STAKED, asset_id, [&]() { return string("asset (" + to_string(asset_id) + ") is not staked"); });
+            }
+
+            removed.push_back(*entry_itr);
+            entries.erase(entry_itr);
+        }
+
+        save_bucket(bucket_tbl, &*bucket_itr, user, bucket_itr->lo_id, entries);
+    }
+
+    return removed;
+}
+
+template <typename Visitor>
+uint64_t ezstake::walk_assets(const config& conf, const name& user, const uint64_t& from_id, const uint32_t& max_rows, Visitor&& visit)
+{
+    if (conf.storage_mode.value_or(ROWS) == BUCKETS) {
+        return bucket_walk(user, from_id, max_rows, [&](const bucket_entry& entry) {
+            visit(entry.asset_id, get_slot_template(entry.slot), time_point_sec(entry.time));
+            return false;
+        });
+    }
+
+    // get asset table instance
+    asset_t asset_tbl(get_self(), get_self().value);
+
+    uint64_t cursor = 0;
+
+    with_owner_index(conf, asset_tbl, user, from_id, [&](auto& owner_idx, auto owner_itr) {
+        for (uint32_t i = 0; i < max_rows && owner_itr != owner_idx.end() && owner_itr->owner == user; i++, owner_itr++) {
+            visit(owner_itr->asset_id, get_template_id(*owner_itr), owner_itr->last_claim);
+        }
+
+        cursor = owner_itr != owner_idx.end() && owner_itr->owner == user ? owner_itr->asset_id : 0;
+    });
+
+    return cursor;
+}
+
+template <typename Walk>
+void ezstake::with_owner_index(const config& conf, asset_t& asset_tbl, const name& user, const uint64_t& from_id, Walk&& walk)
+{
+    if (conf.is_indexed.value_or(false)) {
+        // get the secondary index
+        auto owner_idx = asset_tbl.get_index<name("ownerasset")>();
+
+        walk(owner_idx, owner_idx.lower_bound(owner_asset_key(user, from_id)));
+        return;
+    }
+
+    // get the secondary index
+    auto owner_idx = asset_tbl.get_index<name("owner")>();
+    auto owner_itr = owner_idx.lower_bound(user.value);
+
+    // skip the rows before from_id, one by one
+    while (owner_itr != owner_idx.end() && owner_itr->owner == user && owner_itr->asset_id < from_id) {
+        owner_itr++;
+    }
+
+    walk(owner_idx, owner_itr);
+}
+
+template <typename Visitor>
+uint64_t ezstake::bucket_walk(const name& user, const uint64_t& from_id, const uint32_t& max_rows, Visitor&& remove)
+{
+    // get buckets table instance
+    bucket_t bucket_tbl(get_self(), get_self().value);
+
+    // get the secondary index
+    auto bucket_idx = bucket_tbl.get_index<name("ownerrange")>();
+
+    auto bucket_itr = find_bucket(bucket_idx, user, from_id);
+
+    // from_id is below the user's first bucket
+    if (bucket_itr == bucket_idx.end()) {
+        bucket_itr = bucket_idx.lower_bound(owner_asset_key(user, from_id));
+    }
+
+    uint64_t cursor = 0;
+    uint32_t rows = 0;
+
+    while (cursor == 0 && bucket_itr != bucket_idx.end() && bucket_itr->owner == user) {
+        auto next_itr = bucket_itr;
+        next_itr++;
+
+        vector<bucket_entry> entries = {};
+        entries.reserve(bucket_itr->entries.size());
+
+        for (const bucket_entry& entry : bucket_itr->entries) {
+            // keep the entries outside of this page
+            if (entry.asset_id < from_id || cursor != 0) {
+                entries.push_back(entry);
+            } else if (rows == max_rows) {
+                cursor = entry.asset_id;
+                entries.push_back(entry);
+            } else {
+                rows++;
+
+                if (!remove(entry)) {
+                    entries.push_back(entry);
+                }
+            }
+        }
+
+        if (entries.size() != bucket_itr->entries.size()) {
+            save_bucket(bucket_tbl, &*bucket_itr, user, bucket_itr->lo_id, entries);
+        }
+
+        bucket_itr = next_itr;
+    }
+
+    return cursor;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+// the table deltas dump read by the indexer (and written by the simulation with --deltas)
+// a flattened state-history stream: one record per contract row delta, the row serialized like on chain
+//
+//     file:   "EZDELTA1", then the records back to back
+//     record: uint32 size of the rest of the record
+//             uint32 block_num, uint32 block_time (seconds), uint8 present (0 when the row was removed)
+//             uint64 code, uint64 scope, uint64 table, uint64 primary_key
+//             varuint32 size of the row, then the row (empty when removed)
+
+#include <ezstake.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// the contract's table rows and reward math, for the host-side tools
+struct ezstake_indexer {
+    using user_s = ezstake::user_s;
+    using asset_s = ezstake::asset_s;
+    using template_s = ezstake::template_s;
+    using epoch_s = ezstake::epoch_s;
+    using pool_s = ezstake::pool_s;
+    using config = ezstake::config;
+
+    static constexpr uint8_t PER_ASSET = ezstake::PER_ASSET;
+    static constexpr uint8_t ACCRUAL = ezstake::ACCRUAL;
+    static constexpr uint8_t POOL = ezstake::POOL;
+
+    // see ezstake::get_checkpoint_accrued
+    static asset checkpoint_accrued(const user_s& user_row, const time_point_sec& now) { return ezstake::get_checkpoint_accrued(user_row, now); }
+
+    // see ezstake::advance_pool
+    static pool_s advance_pool(const config& conf, const pool_s& pool, const time_point_sec& now) { return ezstake::advance_pool(conf, pool, now); }
+
+    // see ezstake::get_pool_accrued
+    static asset pool_accrued(const user_s& user_row, const pool_s& pool) { return ezstake::get_pool_accrued(user_row, pool); }
+
+    // see ezstake::epoch_integral
+    static uint128_t epoch_integral(const epoch_s& epoch, const time_point_sec& t) { return ezstake::epoch_integral(epoch, t); }
+};
+
+namespace deltas {
+
+const char MAGIC[8] = { 'E', 'Z', 'D', 'E', 'L', 'T', 'A', '1' };
+
+// size of a record before its row
+constexpr size_t HEADER_SIZE = 4 + 4 + 1 + 8 * 4;
+
+// the fields of the table rows, in their declaration order
+template <typename Io>
+void fields(Io& io, ezstake_indexer::user_s& row) { io(row.user, row.hourly_rate, row.accrued, row.last_update, row.last_claim, row.reward_debt); }
+
+template <typename Io>
+void fields(Io& io, ezstake_indexer::asset_s& row) { io(row.asset_id, row.owner, row.last_claim, row.template_id, row.collection); }
+
+template <typename Io>
+void fields(Io& io, ezstake_indexer::template_s& row) { io(row.template_id, row.collection, row.hourly_rate, row.staked, row.from_rule); }
+
+template <typename Io>
+void fields(Io& io, ezstake_indexer::epoch_s& row) { io(row.start, row.hourly_rate, row.integral); }
+
+template <typename Io>
+void fields(Io& io, ezstake_indexer::pool_s& row) { io(row.acc_reward_per_power, row.total_power, row.last_update); }
+
+template <typename Io>
+void fields(Io& io, ezstake_indexer::config& row)
+{
+    io(row.is_frozen, row.token_contract, row.token_symbol, row.min_claim_period, row.unstake_period,
+        row.reward_mode, row.storage_mode, row.hourly_emission, row.min_payout, row.ram_mode);
+}
+
+// serializes the rows like the contract does, the binary extensions are only written when set
+struct row_writer {
+    std::vector<char> bytes;
+
+    template <typename... Fields>
+    void operator()(const Fields&... values) { (write(values), ...); }
+
+    void raw(const void* data, const size_t& size)
+    {
+        const char* begin = static_cast<const char*>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+
+    template <typename T>
+    std::enable_if_t<std::is_integral_v<T>> write(const T& value) { raw(&value, sizeof(value)); }
+
+    void write(const uint128_t& value) { raw(&value, sizeof(value)); }
+    void write(const name& value) { write(value.value); }
+    void write(const symbol& value) { write(value.raw()); }
+    void write(const asset& value)
+    {
+        write(value.amount);
+        write(value.symbol);
+    }
+
+    void write(const time_point_sec& value) { write(value.sec_since_epoch()); }
+
+    template <typename T>
+    void write(const binary_extension<T>& value)
+    {
+        if (value.has_value()) {
+            write(value.value());
+        }
+    }
+
+    void write_varuint(uint32_t value)
+    {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            write(uint8_t(byte | (value > 0 ? 0x80 : 0)));
+        } while (value > 0);
+    }
+};
+
+// deserializes the rows, the binary extensions are read while there's bytes left
+// a truncated row marks the reader as failed instead of throwing, so a bad record doesn't stop the decoding
+struct row_reader {
+    const char* pos;
+    const char* end;
+    bool failed = false;
+
+    template <typename... Fields>
+    void operator()(Fields&... values) { (read(values), ...); }
+
+    bool raw(void* data, const size_t& size)
+    {
+        if (size_t(end - pos) < size) {
+            failed = true;
+            return false;
+        }
+
+        std::memcpy(data, pos, size);
+        pos += size;
+
+        return true;
+    }
+
+    template <typename T>
+    std::enable_if_t<std::is_integral_v<T>> read(T& value) { raw(&value, sizeof(value)); }
+
+    void read(uint128_t& value) { raw(&value, sizeof(value)); }
+    void read(name& value) { read(value.value); }
+
+    void read(symbol& value)
+    {
+        uint64_t raw_symbol = 0;
+        read(raw_symbol);
+        value = symbol(raw_symbol);
+    }
+
+    void read(asset& value)
+    {
+        read(value.amount);
+        read(value.symbol);
+    }
+
+    void read(time_point_sec& value)
+    {
+        uint32_t seconds = 0;
+        read(seconds);
+        value = time_point_sec(seconds);
+    }
+
+    template <typename T>
+    void read(binary_extension<T>& value)
+    {
+        if (pos < end) {
+            read(value.emplace());
+        }
+    }
+
+    uint32_t read_varuint()
+    {
+        uint32_t value = 0;
+
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t byte = 0;
+
+            if (!raw(&byte, 1)) {
+                return 0;
+            }
+
+            value |= uint32_t(byte & 0x7f) << shift;
+
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+
+        return value;
+    }
+};
+
+// a record without its row
+struct record_header {
+    uint32_t block_num;
+    uint32_t block_time;
+    bool present;
+    uint64_t code;
+    uint64_t scope;
+    uint64_t table;
+    uint64_t primary_key;
+};
+
+// appends the records to a dump file
+class writer {
+public:
+    explicit writer(const std::string& path)
+        : _file(path, std::ios::binary)
+    {
+        _file.write(MAGIC, sizeof(MAGIC));
+    }
+
+    bool good() const { return bool(_file); }
+
+    uint64_t records() const { return _records; }
+
+    // write a row delta, `row` is ignored when the row was removed
+    template <typename Row>
+    void write(const record_header& header, Row row)
+    {
+        row_writer row_bytes;
+
+        if (header.present) {
+            fields(row_bytes, row);
+        }
+
+        row_writer record;
+
+        record.write(header.block_num);
+        record.write(header.block_time);
+        record.write(uint8_t(header.present));
+        record.write(header.code);
+        record.write(header.scope);
+        record.write(header.table);
+        record.write(header.primary_key);
+        record.write_varuint(uint32_t(row_bytes.bytes.size()));
+        record.raw(row_bytes.bytes.data(), row_bytes.bytes.size());
+
+        const uint32_t size = uint32_t(record.bytes.size());
+
+        _file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        _file.write(record.bytes.data(), record.bytes.size());
+        _records++;
+    }
+
+private:
+    std::ofstream _file;
+    uint64_t _records = 0;
+};
+
+} // namespace deltas
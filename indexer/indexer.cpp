@@ -0,0 +1,318 @@
+// off-chain indexer of the ezstake contract
+// rebuilds the users, staked assets and templates from a table deltas dump (see deltas.hpp)
+// and reports the pending rewards of the users along with the totals of the contract
+//
+// the records are decoded by a pool of threads, chunk by chunk, while the main thread applies the decoded chunks in order
+
+#include "store.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+struct options {
+    std::string input;
+    uint64_t contract = name("ezstake").value;
+    uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t chunk_records = 65536;
+    // 0 computes the rewards up to the last block of the dump
+    uint32_t at = 0;
+    uint32_t top = 10;
+    std::vector<name> users;
+    std::string csv;
+};
+
+void usage()
+{
+    std::cerr << "usage: indexer --input FILE [--contract NAME] [--threads N] [--chunk N]\n"
+                 "               [--at SECONDS] [--top N] [--user NAME]... [--csv FILE]\n";
+    std::exit(2);
+}
+
+options parse_options(int argc, char** argv)
+{
+    options opts;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (i + 1 >= argc) {
+            usage();
+        }
+
+        const std::string value = argv[++i];
+
+        if (arg == "--input") {
+            opts.input = value;
+        } else if (arg == "--contract") {
+            opts.contract = name(value).value;
+        } else if (arg == "--threads") {
+            opts.threads = std::stoul(value);
+        } else if (arg == "--chunk") {
+            opts.chunk_records = std::stoul(value);
+        } else if (arg == "--at") {
+            opts.at = std::stoul(value);
+        } else if (arg == "--top") {
+            opts.top = std::stoul(value);
+        } else if (arg == "--user") {
+            opts.users.push_back(name(value));
+        } else if (arg == "--csv") {
+            opts.csv = value;
+        } else {
+            usage();
+        }
+    }
+
+    if (opts.input.empty() || opts.threads == 0 || opts.chunk_records == 0) {
+        usage();
+    }
+
+    return opts;
+}
+
+// load the whole dump, the records are then decoded in place
+std::vector<char> read_file(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        std::cerr << "can't open " << path << "\n";
+        std::exit(1);
+    }
+
+    std::vector<char> bytes(size_t(file.tellg()));
+
+    file.seekg(0);
+    file.read(bytes.data(), bytes.size());
+
+    if (bytes.size() < sizeof(deltas::MAGIC) || std::memcmp(bytes.data(), deltas::MAGIC, sizeof(deltas::MAGIC)) != 0) {
+        std::cerr << path << " is not a deltas dump\n";
+        std::exit(1);
+    }
+
+    return bytes;
+}
+
+// a range of records, decoded by one of the threads
+struct chunk {
+    const char* begin;
+    const char* end;
+    std::vector<indexer::delta> deltas;
+    uint64_t skipped = 0;
+    bool ready = false;
+};
+
+// split the records into chunks of `records` records, only reading their sizes
+std::vector<chunk> split_chunks(const std::vector<char>& bytes, const uint32_t& records)
+{
+    std::vector<chunk> chunks = {};
+
+    const char* pos = bytes.data() + sizeof(deltas::MAGIC);
+    const char* end = bytes.data() + bytes.size();
+
+    while (pos < end) {
+        chunk c = {};
+        c.begin = pos;
+
+        for (uint32_t i = 0; i < records && end - pos >= 4; i++) {
+            uint32_t size = 0;
+            std::memcpy(&size, pos, sizeof(size));
+
+            if (size_t(end - pos - 4) < size) {
+                std::cerr << "truncated record at offset " << (pos - bytes.data()) << ", ignoring the rest of the dump\n";
+                end = pos;
+                break;
+            }
+
+            pos += 4 + size;
+        }
+
+        c.end = pos;
+
+        if (c.end > c.begin) {
+            chunks.push_back(std::move(c));
+        }
+
+        // a trailing partial size
+        if (end - pos < 4) {
+            break;
+        }
+    }
+
+    return chunks;
+}
+
+// decode the records of a chunk, the other contracts/tables and the malformed records are counted as skipped
+void decode_chunk(chunk& c, const uint64_t& contract)
+{
+    for (const char* pos = c.begin; pos < c.end;) {
+        uint32_t size = 0;
+        std::memcpy(&size, pos, sizeof(size));
+
+        deltas::row_reader reader { pos + 4, pos + 4 + size };
+        deltas::record_header header = {};
+        uint8_t present = 0;
+
+        reader(header.block_num, header.block_time, present, header.code, header.scope, header.table, header.primary_key);
+        header.present = present != 0;
+
+        const uint32_t row_size = reader.read_varuint();
+
+        indexer::delta d = {};
+
+        if (!reader.failed && size_t(reader.end - reader.pos) >= row_size && indexer::decode(header, reader.pos, row_size, contract, d)) {
+            c.deltas.push_back(std::move(d));
+        } else {
+            c.skipped++;
+        }
+
+        pos += 4 + size;
+    }
+}
+
+std::string amount_string(const int64_t& amount, const symbol& sym)
+{
+    return asset(amount, sym).to_string();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const options opts = parse_options(argc, argv);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const std::vector<char> bytes = read_file(opts.input);
+    std::vector<chunk> chunks = split_chunks(bytes, opts.chunk_records);
+
+    const auto loaded = std::chrono::steady_clock::now();
+
+    // decode the chunks on the threads, apply them in order as they're ready
+    std::mutex mutex;
+    std::condition_variable decoded;
+    std::atomic<size_t> next_chunk = 0;
+
+    std::vector<std::thread> threads = {};
+
+    for (uint32_t t = 0; t < std::min<size_t>(opts.threads, chunks.size()); t++) {
+        threads.emplace_back([&]() {
+            for (size_t i = next_chunk++; i < chunks.size(); i = next_chunk++) {
+                decode_chunk(chunks[i], opts.contract);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    chunks[i].ready = true;
+                }
+
+                decoded.notify_all();
+            }
+        });
+    }
+
+    indexer::store state;
+
+    uint64_t applied = 0;
+    uint64_t skipped = 0;
+
+    for (chunk& c : chunks) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decoded.wait(lock, [&]() { return c.ready; });
+        }
+
+        for (const indexer::delta& d : c.deltas) {
+            state.apply(d);
+        }
+
+        applied += c.deltas.size();
+        skipped += c.skipped;
+
+        // free the decoded rows as soon as they're applied
+        std::vector<indexer::delta>().swap(c.deltas);
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    const auto ingested = std::chrono::steady_clock::now();
+
+    // compute the rewards
+    const time_point_sec at = time_point_sec(opts.at > 0 ? opts.at : state.last_block_time());
+
+    indexer::aggregates totals = {};
+    std::vector<indexer::user_view> views = state.compute(at, totals);
+
+    const auto computed = std::chrono::steady_clock::now();
+
+    auto seconds = [](const auto& from, const auto& to) { return std::chrono::duration<double>(to - from).count(); };
+
+    const uint64_t records = applied + skipped;
+    const double ingest_seconds = seconds(start, ingested);
+
+    std::cout << "ezstake indexer: " << records << " records (" << bytes.size() / (1024 * 1024) << " MiB) in " << chunks.size() << " chunks, "
+              << std::min<size_t>(opts.threads, chunks.size()) << " decoding threads\n";
+    std::cout << "  load: " << seconds(start, loaded) << "s\n";
+    std::cout << "  decode & apply: " << seconds(loaded, ingested) << "s, " << applied << " deltas applied, " << skipped << " records skipped\n";
+    std::cout << "  rewards: " << seconds(ingested, computed) << "s\n";
+    std::cout << "ingest: " << uint64_t(records / std::max(ingest_seconds, 1e-9)) << " records/sec\n";
+
+    const char* mode_names[] = { "per-asset", "accrual", "pool" };
+    const symbol sym = state.token_symbol();
+
+    std::cout << "state at " << at.sec_since_epoch() << ": " << (totals.reward_mode <= ezstake_indexer::POOL ? mode_names[totals.reward_mode] : "unknown") << " mode, "
+              << totals.users << " users, " << totals.staked_assets << " staked assets";
+
+    if (totals.unresolved_assets > 0) {
+        std::cout << " (" << totals.unresolved_assets << " without a cached template)";
+    }
+
+    std::cout << ", total power " << amount_string(int64_t(totals.total_power), sym) << ", pending " << amount_string(totals.total_pending, sym) << "\n";
+
+    // the requested users, or the ones with the most pending rewards
+    std::vector<indexer::user_view> listed = {};
+
+    if (opts.users.empty()) {
+        listed = views;
+
+        const size_t count = std::min<size_t>(opts.top, listed.size());
+
+        std::partial_sort(listed.begin(), listed.begin() + count, listed.end(), [](const auto& a, const auto& b) { return a.pending > b.pending; });
+        listed.resize(count);
+    } else {
+        for (const name& user : opts.users) {
+            const auto& view_itr = std::find_if(views.begin(), views.end(), [&](const auto& view) { return view.user == user; });
+
+            if (view_itr == views.end()) {
+                std::cout << "  " << user.to_string() << ": not registered\n";
+            } else {
+                listed.push_back(*view_itr);
+            }
+        }
+    }
+
+    for (const indexer::user_view& view : listed) {
+        std::cout << "  " << view.user.to_string() << ": pending " << amount_string(view.pending, sym) << ", rate " << amount_string(view.hourly_rate, sym)
+                  << ", " << view.staked_assets << " staked assets\n";
+    }
+
+    // every user, for the other tools
+    if (!opts.csv.empty()) {
+        std::ofstream csv(opts.csv);
+
+        csv << "user,hourly_rate,staked_assets,pending\n";
+
+        for (const indexer::user_view& view : views) {
+            csv << view.user.to_string() << "," << view.hourly_rate << "," << view.staked_assets << "," << view.pending << "\n";
+        }
+    }
+
+    return 0;
+}
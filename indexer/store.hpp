@@ -0,0 +1,378 @@
+#pragma once
+
+// in-memory state of the contract rebuilt from its table deltas
+// the users and the staked assets are kept column by column, so the reward computations stream through the columns they need
+
+#include "deltas.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <variant>
+
+namespace indexer {
+
+using user_s = ezstake_indexer::user_s;
+using asset_s = ezstake_indexer::asset_s;
+using template_s = ezstake_indexer::template_s;
+using epoch_s = ezstake_indexer::epoch_s;
+using pool_s = ezstake_indexer::pool_s;
+using config = ezstake_indexer::config;
+
+// a decoded record, the row is empty when it was removed
+struct delta {
+    deltas::record_header header;
+    std::variant<std::monostate, user_s, asset_s, template_s, epoch_s, pool_s, config> row;
+};
+
+// decode the row of a record of the contract's tables
+// returns false for the other tables and contracts, and for the malformed rows
+inline bool decode(const deltas::record_header& header, const char* row, const uint32_t& size, const uint64_t& code, delta& out)
+{
+    out.header = header;
+    out.row = std::monostate {};
+
+    if (header.code != code) {
+        return false;
+    }
+
+    deltas::row_reader reader { row, row + size };
+
+    auto read = [&](auto decoded) {
+        if (header.present) {
+            deltas::fields(reader, decoded);
+        }
+
+        out.row = std::move(decoded);
+
+        return !reader.failed;
+    };
+
+    switch (header.table) {
+    case name("users").value:
+        return read(user_s {});
+    case name("assets").value:
+        return read(asset_s {});
+    case name("templates").value:
+        return read(template_s {});
+    case name("epochs").value:
+        return read(epoch_s {});
+    case name("pool").value:
+        return read(pool_s {});
+    case name("config").value:
+        return read(config {});
+    default:
+        return false;
+    }
+}
+
+// the pending rewards and staked assets of a user
+struct user_view {
+    name user;
+    int64_t hourly_rate;
+    uint64_t staked_assets;
+    int64_t pending;
+};
+
+// the totals of the contract
+struct aggregates {
+    uint8_t reward_mode = ezstake_indexer::PER_ASSET;
+    uint64_t users = 0;
+    uint64_t staked_assets = 0;
+    // staked assets without a cached template, their rewards can't be computed off-chain (per-asset mode)
+    uint64_t unresolved_assets = 0;
+    uint64_t total_power = 0;
+    int64_t total_pending = 0;
+};
+
+class store {
+public:
+    // apply a delta, in the order of the dump
+    void apply(const delta& d)
+    {
+        if (std::holds_alternative<user_s>(d.row)) {
+            apply_user(d.header, std::get<user_s>(d.row));
+        } else if (std::holds_alternative<asset_s>(d.row)) {
+            apply_asset(d.header, std::get<asset_s>(d.row));
+        } else if (std::holds_alternative<template_s>(d.row)) {
+            if (d.header.present) {
+                _templates[int32_t(d.header.primary_key)] = std::get<template_s>(d.row);
+            } else {
+                _templates.erase(int32_t(d.header.primary_key));
+            }
+        } else if (std::holds_alternative<epoch_s>(d.row)) {
+            apply_epoch(d.header, std::get<epoch_s>(d.row));
+        } else if (std::holds_alternative<pool_s>(d.row)) {
+            _pool = d.header.present ? std::get<pool_s>(d.row) : pool_s {};
+        } else if (std::holds_alternative<config>(d.row)) {
+            _config = d.header.present ? std::get<config>(d.row) : config {};
+        }
+
+        _last_block_time = std::max(_last_block_time, d.header.block_time);
+    }
+
+    uint32_t last_block_time() const { return _last_block_time; }
+
+    // the reward token of the contract
+    symbol token_symbol() const { return _config.token_symbol; }
+
+    // compute the rewards every user accrued up to `at`, like getpending, cooldowns aside
+    // returns the users in the order of the columns
+    std::vector<user_view> compute(const time_point_sec& at, aggregates& totals) const
+    {
+        const uint8_t reward_mode = _config.reward_mode.value_or(ezstake_indexer::PER_ASSET);
+        const pool_s pool = ezstake_indexer::advance_pool(_config, _pool, at);
+
+        std::vector<user_view> views(_user_name.size());
+        std::vector<int64_t> asset_rewards(_user_name.size(), 0);
+
+        // stream the assets columns once for the staked counts and the per-asset rewards
+        std::unordered_map<int32_t, uint128_t> integrals_at = {};
+
+        totals = {};
+        totals.reward_mode = reward_mode;
+
+        for (size_t i = 0; i < _asset_id.size(); i++) {
+            const auto& user_itr = _user_index.find(_asset_owner[i]);
+
+            totals.staked_assets++;
+
+            if (user_itr == _user_index.end()) {
+                continue;
+            }
+
+            views[user_itr->second].staked_assets++;
+
+            if (reward_mode != ezstake_indexer::PER_ASSET && _user_checkpointed[user_itr->second]) {
+                continue;
+            }
+
+            if (_asset_template[i] == NO_TEMPLATE) {
+                totals.unresolved_assets++;
+                continue;
+            }
+
+            const int32_t template_id = _asset_template[i];
+            const auto& template_itr = _templates.find(template_id);
+
+            // the removed templates can't be claimed
+            if (template_itr == _templates.end()) {
+                continue;
+            }
+
+            auto integral_itr = integrals_at.find(template_id);
+
+            if (integral_itr == integrals_at.end()) {
+                integral_itr = integrals_at.emplace(template_id, integral(template_itr->second, at)).first;
+            }
+
+            asset_rewards[user_itr->second] += int64_t((integral_itr->second - integral(template_itr->second, time_point_sec(_asset_last_claim[i]))) / 3600);
+        }
+
+        for (size_t i = 0; i < _user_name.size(); i++) {
+            const user_s row = user_row(i);
+
+            user_view& view = views[i];
+
+            view.user = row.user;
+            view.hourly_rate = row.hourly_rate.amount;
+
+            if (reward_mode == ezstake_indexer::POOL) {
+                view.pending = ezstake_indexer::pool_accrued(row, pool).amount;
+            } else if (reward_mode == ezstake_indexer::ACCRUAL && row.last_update.has_value()) {
+                view.pending = ezstake_indexer::checkpoint_accrued(row, at).amount;
+            } else {
+                view.pending = asset_rewards[i];
+            }
+
+            totals.users++;
+            totals.total_power += uint64_t(row.hourly_rate.amount);
+            totals.total_pending += view.pending;
+        }
+
+        return views;
+    }
+
+private:
+    static constexpr int32_t NO_TEMPLATE = -1;
+
+    // ------------ users columns ------------
+    std::vector<uint64_t> _user_name;
+    std::vector<asset> _user_rate;
+    std::vector<asset> _user_accrued;
+    std::vector<uint32_t> _user_last_update;
+    std::vector<uint32_t> _user_last_claim;
+    std::vector<uint128_t> _user_reward_debt;
+    // whether the user has an accrual checkpoint, the ones without are still rewarded per asset
+    std::vector<uint8_t> _user_checkpointed;
+    // column position of each user
+    std::unordered_map<uint64_t, size_t> _user_index;
+
+    // ------------ assets columns ------------
+    std::vector<uint64_t> _asset_id;
+    std::vector<uint64_t> _asset_owner;
+    std::vector<uint32_t> _asset_last_claim;
+    std::vector<int32_t> _asset_template;
+    // column position of each asset
+    std::unordered_map<uint64_t, size_t> _asset_index;
+
+    // ------------ small tables ------------
+    std::unordered_map<int32_t, template_s> _templates;
+    // rate history of the templates, sorted by start
+    std::unordered_map<int32_t, std::vector<epoch_s>> _epochs;
+    pool_s _pool = {};
+    config _config = {};
+    uint32_t _last_block_time = 0;
+
+    // rebuild the contract row of the user at a column position
+    user_s user_row(const size_t& i) const
+    {
+        user_s row = {};
+
+        row.user = name(_user_name[i]);
+        row.hourly_rate = _user_rate[i];
+
+        if (_user_checkpointed[i]) {
+            row.accrued = _user_accrued[i];
+            row.last_update = time_point_sec(_user_last_update[i]);
+            row.last_claim = time_point_sec(_user_last_claim[i]);
+        }
+
+        row.reward_debt = _user_reward_debt[i];
+
+        return row;
+    }
+
+    // get the reward generated by one asset of the template from the beginning up to `t`, like ezstake::get_integral
+    uint128_t integral(const template_s& tmpl, const time_point_sec& t) const
+    {
+        const auto& epochs_itr = _epochs.find(tmpl.template_id);
+
+        if (epochs_itr == _epochs.end()) {
+            return uint128_t(tmpl.hourly_rate.amount) * t.sec_since_epoch();
+        }
+
+        const auto& epochs = epochs_itr->second;
+
+        // the epoch with the latest start not after `t`
+        auto epoch_itr = std::upper_bound(epochs.begin(), epochs.end(), t.sec_since_epoch(), [](const uint32_t& time, const epoch_s& epoch) { return time < epoch.start.sec_since_epoch(); });
+
+        if (epoch_itr == epochs.begin()) {
+            return uint128_t(tmpl.hourly_rate.amount) * t.sec_since_epoch();
+        }
+
+        return ezstake_indexer::epoch_integral(*(--epoch_itr), t);
+    }
+
+    // remove the row at column position `i` of `columns` by moving the last row into it
+    template <typename... Columns>
+    static void swap_remove(const size_t& i, Columns&... columns)
+    {
+        ((columns[i] = std::move(columns.back()), columns.pop_back()), ...);
+    }
+
+    void apply_user(const deltas::record_header& header, const user_s& row)
+    {
+        const auto& index_itr = _user_index.find(header.primary_key);
+
+        if (!header.present) {
+            if (index_itr == _user_index.end()) {
+                return;
+            }
+
+            const size_t i = index_itr->second;
+
+            _user_index.erase(index_itr);
+            swap_remove(i, _user_name, _user_rate, _user_accrued, _user_last_update, _user_last_claim, _user_reward_debt, _user_checkpointed);
+
+            if (i < _user_name.size()) {
+                _user_index[_user_name[i]] = i;
+            }
+
+            return;
+        }
+
+        size_t i = 0;
+
+        if (index_itr == _user_index.end()) {
+            i = _user_name.size();
+
+            _user_index[header.primary_key] = i;
+            _user_name.push_back(header.primary_key);
+            _user_rate.emplace_back();
+            _user_accrued.emplace_back();
+            _user_last_update.push_back(0);
+            _user_last_claim.push_back(0);
+            _user_reward_debt.push_back(0);
+            _user_checkpointed.push_back(0);
+        } else {
+            i = index_itr->second;
+        }
+
+        _user_rate[i] = row.hourly_rate;
+        _user_accrued[i] = row.accrued.value_or(asset(0, row.hourly_rate.symbol));
+        _user_last_update[i] = row.last_update.value_or().sec_since_epoch();
+        _user_last_claim[i] = row.last_claim.value_or().sec_since_epoch();
+        _user_reward_debt[i] = row.reward_debt.value_or(0);
+        _user_checkpointed[i] = row.last_update.has_value();
+    }
+
+    void apply_asset(const deltas::record_header& header, const asset_s& row)
+    {
+        const auto& index_itr = _asset_index.find(header.primary_key);
+
+        if (!header.present) {
+            if (index_itr == _asset_index.end()) {
+                return;
+            }
+
+            const size_t i = index_itr->second;
+
+            _asset_index.erase(index_itr);
+            swap_remove(i, _asset_id, _asset_owner, _asset_last_claim, _asset_template);
+
+            if (i < _asset_id.size()) {
+                _asset_index[_asset_id[i]] = i;
+            }
+
+            return;
+        }
+
+        size_t i = 0;
+
+        if (index_itr == _asset_index.end()) {
+            i = _asset_id.size();
+
+            _asset_index[header.primary_key] = i;
+            _asset_id.push_back(header.primary_key);
+            _asset_owner.push_back(0);
+            _asset_last_claim.push_back(0);
+            _asset_template.push_back(NO_TEMPLATE);
+        } else {
+            i = index_itr->second;
+        }
+
+        _asset_owner[i] = row.owner.value;
+        _asset_last_claim[i] = row.last_claim.sec_since_epoch();
+        _asset_template[i] = row.template_id.value_or(NO_TEMPLATE);
+    }
+
+    void apply_epoch(const deltas::record_header& header, const epoch_s& row)
+    {
+        auto& epochs = _epochs[int32_t(header.scope)];
+
+        auto epoch_itr = std::lower_bound(epochs.begin(), epochs.end(), header.primary_key, [](const epoch_s& epoch, const uint64_t& start) { return epoch.start.sec_since_epoch() < start; });
+        const bool found = epoch_itr != epochs.end() && epoch_itr->start.sec_since_epoch() == header.primary_key;
+
+        if (!header.present) {
+            if (found) {
+                epochs.erase(epoch_itr);
+            }
+        } else if (found) {
+            *epoch_itr = row;
+        } else {
+            epochs.insert(epoch_itr, row);
+        }
+    }
+};
+
+} // namespace indexer
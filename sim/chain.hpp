@@ -0,0 +1,372 @@
+#pragma once
+
+// host-native chain for the ezstake contract
+// runs the actions against the in-memory tables of sim/include, rolls back the failed ones
+// and applies the inline transfers to the mock atomicassets tables and token balances
+
+#include <ezstake.cpp>
+
+#include "../indexer/deltas.hpp"
+
+#include <any>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct ezstake_sim {
+    using user_t = ezstake::user_t;
+    using asset_t = ezstake::asset_t;
+    using template_t = ezstake::template_t;
+    using bucket_t = ezstake::bucket_t;
+    using count_t = ezstake::count_t;
+    using rerate_t = ezstake::rerate_t;
+    using set_t = ezstake::set_t;
+    using boost_t = ezstake::boost_t;
+    using reward_t = ezstake::reward_t;
+    using stats_t = ezstake::stats_t;
+    using pool_t = ezstake::pool_t;
+    using config_t = ezstake::config_t;
+
+    name self = name("ezstake");
+    name collection = name("dummycol");
+
+    // reward token balances of the users, by account
+    std::map<uint64_t, int64_t> balances;
+
+    uint64_t next_asset_id = 1099511627776;
+
+    // where to dump the table deltas of the committed transactions, one block per transaction (see indexer/deltas.hpp)
+    deltas::writer* delta_writer = nullptr;
+    uint32_t block_num = 0;
+
+    // wipe every table and start the chain at `time`
+    void reset(const uint32_t& time)
+    {
+        mock::reset_tables();
+        balances.clear();
+        next_asset_id = 1099511627776;
+        block_num = 0;
+
+        mock::env().accounts = { name("eosio.token").value, name("atomicassets").value, self.value };
+        set_time(time);
+    }
+
+    void set_time(const uint32_t& time) { mock::env().now = time_point(seconds(time)); }
+
+    uint32_t now() const { return mock::env().now.sec_since_epoch(); }
+
+    // run `apply` as a transaction authorized by `auth`
+    // returns the assert message if it failed, after rolling back all its writes
+    std::string push(const name& auth, const std::function<void(ezstake&)>& apply)
+    {
+        mock::begin_transaction();
+        mock::env().auths = { auth.value };
+        mock::env().console.clear();
+        mock::sent_actions().clear();
+
+        ezstake contract(self, self, datastream<const char*>(nullptr, 0));
+
+        try {
+            apply(contract);
+            apply_inline_actions();
+        } catch (const eosio_assert_exception& e) {
+            mock::rollback_transaction();
+            return e.what();
+        } catch (const eosio_assert_code_exception& e) {
+            mock::rollback_transaction();
+            return e.what();
+        }
+
+        if (delta_writer != nullptr) {
+            write_deltas();
+        }
+
+        return "";
+    }
+
+    // create a template in the mock atomicassets
+    void create_template(const int32_t& template_id)
+    {
+        atomicassets::get_templates(collection).emplace(name("atomicassets"), [&](auto& row) {
+            row.template_id = template_id;
+            row.schema_name = name("dummyschema");
+        });
+    }
+
+    // mint an asset of the template to `owner` in the mock atomicassets
+    uint64_t mint(const name& owner, const int32_t& template_id)
+    {
+        const uint64_t asset_id = next_asset_id++;
+
+        atomicassets::get_assets(owner).emplace(name("atomicassets"), [&](auto& row) {
+            row.asset_id = asset_id;
+            row.collection_name = collection;
+            row.schema_name = name("dummyschema");
+            row.template_id = template_id;
+        });
+
+        return asset_id;
+    }
+
+    // transfer the assets to the contract with the stake memo
+    std::string stake(const name& user, const std::vector<uint64_t>& asset_ids)
+    {
+        return push(user, [&](ezstake& contract) {
+            move_assets(user, self, asset_ids);
+            contract.receiveassets(user, self, asset_ids, "stake");
+        });
+    }
+
+    // check the accounting invariants of the contract tables
+    // returns a description of the first violated one, or an empty string
+    std::string check_invariants()
+    {
+        const auto conf = config_t(self, self.value).get();
+
+        user_t user_tbl(self, self.value);
+        template_t template_tbl(self, self.value);
+        count_t count_tbl(self, self.value);
+        rerate_t rerate_tbl(self, self.value);
+        boost_t boost_tbl(self, self.value);
+        reward_t reward_tbl(self, self.value);
+
+        // the staked assets per template, from the storage itself
+        std::map<int32_t, uint64_t> staked = {};
+        uint64_t staked_assets = 0;
+
+        asset_t asset_tbl(self, self.value);
+        ezstake contract(self, self, datastream<const char*>(nullptr, 0));
+
+        for (const auto& row : asset_tbl) {
+            staked[contract.get_template_id(row)]++;
+            staked_assets++;
+        }
+
+        bucket_t bucket_tbl(self, self.value);
+
+        for (const auto& bucket : bucket_tbl) {
+            for (const auto& entry : bucket.entries) {
+                staked[contract.get_slot_template(entry.slot)]++;
+                staked_assets++;
+            }
+        }
+
+        const auto& aa_assets = atomicassets::get_assets(self);
+        const uint64_t held_assets = std::distance(aa_assets.begin(), aa_assets.end());
+
+        if (held_assets != staked_assets) {
+            return "the contract holds " + std::to_string(held_assets) + " assets but " + std::to_string(staked_assets) + " are staked";
+        }
+
+        // every user's rate is the sum of its counts at their recorded rate and of its set boosts
+        // and its extra rates are the sum of its counts at their recorded extra rates
+        std::map<uint64_t, int64_t> counted_rate = {};
+        std::map<uint64_t, std::vector<extended_asset>> counted_extras = {};
+        std::map<int32_t, uint64_t> counted = {};
+
+        for (const auto& row : count_tbl) {
+            counted_rate[row.user.value] += int64_t(row.count) * row.hourly_rate.amount;
+            counted[row.template_id] += row.count;
+            ezstake::add_rates(counted_extras[row.user.value], row.extra_rates.value_or(), int64_t(row.count));
+
+            const auto& template_itr = template_tbl.find(uint64_t(row.template_id));
+
+            // the counts only lag behind the templates pending a re-rate
+            if (template_itr != template_tbl.end() && template_itr->hourly_rate != row.hourly_rate && rerate_tbl.find(uint64_t(row.template_id)) == rerate_tbl.end()) {
+                return "count of " + row.user.to_string() + " is at a stale rate for template " + std::to_string(row.template_id);
+            }
+        }
+
+        for (const auto& row : boost_tbl) {
+            counted_rate[row.user.value] += row.bonus_rate.amount;
+        }
+
+        for (const auto& row : reward_tbl) {
+            auto extras = counted_extras[row.user.value];
+
+            ezstake::add_rates(extras, row.hourly_rates, -1);
+
+            if (!extras.empty()) {
+                return "extra rates of " + row.user.to_string() + " don't match its counts";
+            }
+
+            counted_extras.erase(row.user.value);
+        }
+
+        for (const auto& [user, extras] : counted_extras) {
+            if (!extras.empty()) {
+                return "extra rates of " + name(user).to_string() + " are missing";
+            }
+        }
+
+        uint64_t users = 0;
+        uint64_t total_power = 0;
+
+        for (const auto& row : user_tbl) {
+            if (row.hourly_rate.amount != counted_rate[row.user.value]) {
+                return "rate of " + row.user.to_string() + " is " + row.hourly_rate.to_string() + " but its counts add up to " + std::to_string(counted_rate[row.user.value]);
+            }
+
+            users++;
+            total_power += row.hourly_rate.amount;
+        }
+
+        for (const auto& row : template_tbl) {
+            // the staked counter of a re-added template catches up with its re-rate
+            const bool is_rerating = rerate_tbl.find(uint64_t(row.template_id)) != rerate_tbl.end();
+
+            if ((!is_rerating && row.staked.value_or(0) != staked[row.template_id]) || counted[row.template_id] != staked[row.template_id]) {
+                return "template " + std::to_string(row.template_id) + " has " + std::to_string(staked[row.template_id]) + " staked assets but counts " + std::to_string(row.staked.value_or(0)) + "/" + std::to_string(counted[row.template_id]);
+            }
+        }
+
+        // the global stats match the tables
+        const auto stats = stats_t(self, self.value).get_or_default();
+
+        int64_t total_claimed = 0;
+
+        for (const auto& [account, balance] : balances) {
+            total_claimed += balance;
+        }
+
+        if (stats.users != users || stats.staked_assets != staked_assets || stats.total_power != total_power || stats.total_claimed != uint64_t(total_claimed)) {
+            return "stats don't match the tables";
+        }
+
+        if (conf.reward_mode.value_or(ezstake::PER_ASSET) == ezstake::POOL && pool_t(self, self.value).get_or_default().total_power != total_power) {
+            return "pool power doesn't match the users' rates";
+        }
+
+        return "";
+    }
+
+    // the rewards accrued by all the users up to now, cooldowns aside
+    int64_t total_pending()
+    {
+        const auto conf = config_t(self, self.value).get();
+
+        user_t user_tbl(self, self.value);
+        ezstake contract(self, self, datastream<const char*>(nullptr, 0));
+
+        const bool is_pool = conf.reward_mode.value_or(ezstake::PER_ASSET) == ezstake::POOL;
+        const ezstake::pool_s pool = is_pool ? contract.peek_pool(conf) : ezstake::pool_s {};
+
+        int64_t pending = 0;
+
+        for (const auto& row : user_tbl) {
+            pending += (is_pool ? contract.get_pool_accrued(row, pool) : contract.get_accrued(conf, row, current_time_point())).amount;
+        }
+
+        return pending;
+    }
+
+private:
+    // write the last version of each row written by the transaction that just succeeded
+    void write_deltas()
+    {
+        const auto& written = mock::written_rows();
+
+        block_num++;
+
+        // the rows already seen walking the writes backwards
+        std::set<std::tuple<uint64_t, uint64_t, uint64_t>> seen = {};
+        std::vector<const mock::written_row*> last_writes = {};
+
+        // only the last write of a row is a delta
+        for (auto itr = written.rbegin(); itr != written.rend(); itr++) {
+            if (itr->code == self.value && seen.insert({ itr->scope, itr->table, itr->primary_key }).second) {
+                last_writes.push_back(&*itr);
+            }
+        }
+
+        for (auto itr = last_writes.rbegin(); itr != last_writes.rend(); itr++) {
+            const mock::written_row& row = **itr;
+
+            const deltas::record_header header = { block_num, now(), false, row.code, row.scope, row.table, row.primary_key };
+
+            switch (row.table) {
+            case name("users").value:
+                write_row<user_t>(header);
+                break;
+            case name("assets").value:
+                write_row<asset_t>(header);
+                break;
+            case name("templates").value:
+                write_row<template_t>(header);
+                break;
+            case name("epochs").value:
+                write_row<ezstake::epoch_t>(header);
+                break;
+            case name("pool").value:
+                write_singleton<pool_t, ezstake::pool_s>(header);
+                break;
+            case name("config").value:
+                write_singleton<config_t, ezstake::config>(header);
+                break;
+            }
+        }
+    }
+
+    template <typename Table>
+    void write_row(deltas::record_header header)
+    {
+        Table tbl(self, header.scope);
+
+        const auto& itr = tbl.find(header.primary_key);
+
+        header.present = itr != tbl.end();
+        delta_writer->write(header, header.present ? *itr : typename Table::value_type {});
+    }
+
+    template <typename Singleton, typename Row>
+    void write_singleton(deltas::record_header header)
+    {
+        Singleton tbl(self, header.scope);
+
+        header.present = tbl.exists();
+        delta_writer->write(header, tbl.get_or_default(Row {}));
+    }
+
+    // move assets between two accounts in the mock atomicassets
+    static void move_assets(const name& from, const name& to, const std::vector<uint64_t>& asset_ids)
+    {
+        auto from_tbl = atomicassets::get_assets(from);
+        auto to_tbl = atomicassets::get_assets(to);
+
+        for (const uint64_t& asset_id : asset_ids) {
+            const auto& asset_itr = from_tbl.require_find(asset_id, "asset not owned by the sender");
+            const auto row = *asset_itr;
+
+            from_tbl.erase(asset_itr);
+            to_tbl.emplace(name("atomicassets"), [&](auto& r) { r = row; });
+        }
+    }
+
+    // apply the transfers sent inline by the contract
+    void apply_inline_actions()
+    {
+        const auto actions = mock::sent_actions();
+
+        for (const auto& act : actions) {
+            if (act.name != name("transfer")) {
+                continue;
+            }
+
+            if (act.account == atomicassets::ATOMICASSETS_ACCOUNT) {
+                const auto& [from, to, asset_ids, memo] = std::any_cast<std::tuple<name, name, std::vector<uint64_t>, std::string>>(act.data);
+
+                move_assets(from, to, asset_ids);
+            } else {
+                const auto& [from, to, quantity, memo] = std::any_cast<std::tuple<name, name, asset, std::string>>(act.data);
+
+                // the extra tokens aren't counted in the stats
+                if (act.account == name("eosio.token")) {
+                    balances[to.value] += quantity.amount;
+                }
+            }
+        }
+    }
+};
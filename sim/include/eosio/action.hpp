@@ -0,0 +1,86 @@
+#pragma once
+
+#include "name.hpp"
+
+#include <any>
+#include <tuple>
+#include <vector>
+
+namespace eosio {
+
+struct permission_level {
+    name actor;
+    name permission;
+};
+
+struct action {
+    std::vector<permission_level> authorization;
+    eosio::name account;
+    eosio::name name;
+    std::any data;
+
+    action() = default;
+
+    template <typename T>
+    action(const permission_level& auth, eosio::name a, eosio::name n, T&& value)
+        : authorization({ auth })
+        , account(a)
+        , name(n)
+        , data(std::forward<T>(value))
+    {
+    }
+
+    template <typename T>
+    action(const std::vector<permission_level>& auths, eosio::name a, eosio::name n, T&& value)
+        : authorization(auths)
+        , account(a)
+        , name(n)
+        , data(std::forward<T>(value))
+    {
+    }
+
+    void send() const;
+    void send_context_free() const { send(); }
+};
+
+namespace mock {
+    inline std::vector<action>& sent_actions()
+    {
+        static std::vector<action> actions;
+        return actions;
+    }
+} // namespace mock
+
+inline void action::send() const { mock::sent_actions().push_back(*this); }
+
+template <name::raw Name, auto Action>
+struct action_wrapper {
+    eosio::name code_name;
+    std::vector<permission_level> permissions;
+
+    action_wrapper(eosio::name code, const permission_level& perm)
+        : code_name(code)
+        , permissions({ perm })
+    {
+    }
+
+    action_wrapper(eosio::name code, const std::vector<permission_level>& perms)
+        : code_name(code)
+        , permissions(perms)
+    {
+    }
+
+    template <typename... Args>
+    action to_action(Args&&... args) const
+    {
+        return action(permissions, code_name, eosio::name(Name), std::make_tuple(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    void send(Args&&... args) const
+    {
+        to_action(std::forward<Args>(args)...).send();
+    }
+};
+
+} // namespace eosio
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "symbol.hpp"
+
+namespace eosio {
+
+struct asset {
+    static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+    int64_t amount = 0;
+    eosio::symbol symbol;
+
+    asset() = default;
+    asset(int64_t a, class symbol s)
+        : amount(a)
+        , symbol(s)
+    {
+        check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+        check(symbol.is_valid(), "invalid symbol name");
+    }
+
+    bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+    bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+
+    asset operator-() const
+    {
+        asset r = *this;
+        r.amount = -r.amount;
+        return r;
+    }
+
+    asset& operator-=(const asset& a)
+    {
+        check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+        amount -= a.amount;
+        check(-max_amount <= amount, "subtraction underflow");
+        check(amount <= max_amount, "subtraction overflow");
+        return *this;
+    }
+
+    asset& operator+=(const asset& a)
+    {
+        check(a.symbol == symbol, "attempt to add asset with different symbol");
+        amount += a.amount;
+        check(-max_amount <= amount, "addition underflow");
+        check(amount <= max_amount, "addition overflow");
+        return *this;
+    }
+
+    asset& operator*=(int64_t a)
+    {
+        int128_t tmp = (int128_t)amount * (int128_t)a;
+        check(tmp <= max_amount, "multiplication overflow");
+        check(tmp >= -max_amount, "multiplication underflow");
+        amount = (int64_t)tmp;
+        return *this;
+    }
+
+    asset& operator/=(int64_t a)
+    {
+        check(a != 0, "divide by zero");
+        amount /= a;
+        return *this;
+    }
+
+    friend asset operator+(const asset& a, const asset& b)
+    {
+        asset r = a;
+        r += b;
+        return r;
+    }
+    friend asset operator-(const asset& a, const asset& b)
+    {
+        asset r = a;
+        r -= b;
+        return r;
+    }
+    friend asset operator*(const asset& a, int64_t b)
+    {
+        asset r = a;
+        r *= b;
+        return r;
+    }
+    friend asset operator/(const asset& a, int64_t b)
+    {
+        asset r = a;
+        r /= b;
+        return r;
+    }
+    friend bool operator==(const asset& a, const asset& b) { return a.amount == b.amount && a.symbol == b.symbol; }
+    friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+    friend bool operator<(const asset& a, const asset& b)
+    {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount < b.amount;
+    }
+    friend bool operator<=(const asset& a, const asset& b)
+    {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount <= b.amount;
+    }
+    friend bool operator>(const asset& a, const asset& b) { return b < a; }
+    friend bool operator>=(const asset& a, const asset& b) { return b <= a; }
+
+    std::string to_string() const
+    {
+        auto p = symbol.precision();
+        bool neg = amount < 0;
+        uint64_t a = neg ? uint64_t(-amount) : uint64_t(amount);
+        std::string digits = std::to_string(a);
+        if (p > 0) {
+            if (digits.size() <= p)
+                digits.insert(0, p - digits.size() + 1, '0');
+            digits.insert(digits.size() - p, ".");
+        }
+        return (neg ? "-" : "") + digits + " " + symbol.code().to_string();
+    }
+};
+
+struct extended_asset {
+    asset quantity;
+    name contract;
+
+    extended_asset() = default;
+    extended_asset(int64_t v, extended_symbol s)
+        : quantity(v, s.get_symbol())
+        , contract(s.get_contract())
+    {
+    }
+    extended_asset(asset a, name c)
+        : quantity(a)
+        , contract(c)
+    {
+    }
+
+    extended_symbol get_extended_symbol() const { return extended_symbol { quantity.symbol, contract }; }
+
+    friend bool operator==(const extended_asset& a, const extended_asset& b)
+    {
+        return a.quantity == b.quantity && a.contract == b.contract;
+    }
+};
+
+} // namespace eosio
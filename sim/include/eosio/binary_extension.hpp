@@ -0,0 +1,64 @@
+#pragma once
+
+#include "name.hpp"
+
+#include <optional>
+#include <utility>
+
+namespace eosio {
+
+template <typename T>
+class binary_extension {
+public:
+    using value_type = T;
+
+    constexpr binary_extension() = default;
+    constexpr binary_extension(const T& ext)
+        : _value(ext)
+    {
+    }
+    constexpr binary_extension(T&& ext)
+        : _value(std::move(ext))
+    {
+    }
+
+    constexpr bool has_value() const { return _value.has_value(); }
+
+    T& value()
+    {
+        check(_value.has_value(), "cannot get value of empty binary_extension");
+        return *_value;
+    }
+
+    const T& value() const
+    {
+        check(_value.has_value(), "cannot get value of empty binary_extension");
+        return *_value;
+    }
+
+    template <typename U>
+    T value_or(U&& def) const
+    {
+        return _value.has_value() ? *_value : static_cast<T>(std::forward<U>(def));
+    }
+
+    T value_or() const { return _value.has_value() ? *_value : T(); }
+
+    T* operator->() { return &value(); }
+    const T* operator->() const { return &value(); }
+    T& operator*() { return value(); }
+    const T& operator*() const { return value(); }
+
+    template <typename... Args>
+    T& emplace(Args&&... args)
+    {
+        return _value.emplace(std::forward<Args>(args)...);
+    }
+
+    void reset() { _value.reset(); }
+
+private:
+    std::optional<T> _value;
+};
+
+} // namespace eosio
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+namespace eosio {
+
+template <typename T>
+class datastream {
+public:
+    datastream(T start = T(), size_t s = 0)
+        : _start(start)
+        , _pos(start)
+        , _end(start + s)
+    {
+    }
+
+    size_t remaining() const { return _end - _pos; }
+
+private:
+    T _start;
+    T _pos;
+    T _end;
+};
+
+} // namespace eosio
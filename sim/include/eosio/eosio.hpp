@@ -0,0 +1,27 @@
+#pragma once
+
+// host-native stand-in for the cdt eosio headers
+// only the subset of the api used by the contracts is provided
+
+#include "action.hpp"
+#include "asset.hpp"
+#include "binary_extension.hpp"
+#include "contract.hpp"
+#include "datastream.hpp"
+#include "multi_index.hpp"
+#include "name.hpp"
+#include "print.hpp"
+#include "symbol.hpp"
+#include "system.hpp"
+#include "time.hpp"
+
+#include <map>
+#include <optional>
+#include <string>
+#include <variant>
+#include <tuple>
+#include <vector>
+
+#define CONTRACT class [[eosio::contract]]
+#define ACTION [[eosio::action]] void
+#define TABLE struct [[eosio::table]]
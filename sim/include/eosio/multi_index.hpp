@@ -0,0 +1,524 @@
+#pragma once
+
+#include "name.hpp"
+
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+constexpr static inline name same_payer {};
+
+namespace mock {
+    // every table instance registers a callback here so the whole database can be wiped between runs
+    inline std::vector<std::function<void()>>& table_resetters()
+    {
+        static std::vector<std::function<void()>> resetters;
+        return resetters;
+    }
+
+    inline void reset_tables()
+    {
+        for (auto& reset : table_resetters())
+            reset();
+    }
+
+    // aggregate RAM accounting per payer (rows only, no per-row byte size estimation)
+    inline std::map<uint64_t, int64_t>& row_counts()
+    {
+        static std::map<uint64_t, int64_t> counts;
+        return counts;
+    }
+
+    // every write pushes its inverse here, so a failed action can be rolled back like a failed transaction
+    inline std::vector<std::function<void()>>& undo_log()
+    {
+        static std::vector<std::function<void()>> log;
+        return log;
+    }
+
+    // a row written by the current transaction
+    struct written_row {
+        uint64_t code;
+        uint64_t scope;
+        uint64_t table;
+        uint64_t primary_key;
+    };
+
+    // every write of the transaction in order, so its table deltas can be read back once it succeeded
+    inline std::vector<written_row>& written_rows()
+    {
+        static std::vector<written_row> rows;
+        return rows;
+    }
+
+    // start a new transaction, the writes before it can't be rolled back anymore
+    inline void begin_transaction()
+    {
+        undo_log().clear();
+        written_rows().clear();
+    }
+
+    // undo every write since the start of the transaction
+    inline void rollback_transaction()
+    {
+        auto& log = undo_log();
+
+        while (!log.empty()) {
+            auto undo = std::move(log.back());
+            log.pop_back();
+            undo();
+        }
+
+        written_rows().clear();
+    }
+} // namespace mock
+
+template <class Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+struct const_mem_fun {
+    typedef typename std::remove_reference<Type>::type result_type;
+
+    template <typename ChainedPtr>
+    auto operator()(const ChainedPtr& x) const -> std::enable_if_t<!std::is_convertible<const ChainedPtr&, const Class&>::value, Type>
+    {
+        return operator()(*x);
+    }
+
+    Type operator()(const Class& x) const { return (x.*PtrToMemberFunction)(); }
+};
+
+template <name::raw IndexName, typename Extractor>
+struct indexed_by {
+    static constexpr name::raw index_name = IndexName;
+    typedef Extractor secondary_extractor_type;
+};
+
+template <name::raw TableName, typename T, typename... Indices>
+class multi_index {
+public:
+    struct row {
+        T value;
+        name payer;
+    };
+
+    template <typename Index>
+    using key_of = typename Index::secondary_extractor_type::result_type;
+
+    // an index key and the primary key it points to, sorted like the chain's secondary indexes
+    // the entry keeps the address of its row (the map nodes don't move), so reading through an index doesn't look the row up again
+    template <typename Key>
+    struct index_entry {
+        Key first;
+        uint64_t second;
+        const T* value = nullptr;
+
+        index_entry(const Key& key, uint64_t pk, const T* row_value = nullptr)
+            : first(key)
+            , second(pk)
+            , value(row_value)
+        {
+        }
+
+        friend bool operator<(const index_entry& a, const index_entry& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); }
+    };
+
+    template <typename Index>
+    using index_set = std::set<index_entry<key_of<Index>>>;
+
+    struct table_data {
+        std::map<uint64_t, row> rows;
+        std::tuple<index_set<Indices>...> indices;
+    };
+
+private:
+    static std::map<std::pair<uint64_t, uint64_t>, table_data>& storage()
+    {
+        static std::map<std::pair<uint64_t, uint64_t>, table_data> data;
+        static bool registered = false;
+        if (!registered) {
+            registered = true;
+            // the tables are emptied rather than erased, the long-lived instances (like atomicassets::collections) keep pointing to them
+            mock::table_resetters().push_back([] {
+                for (auto& [key, data] : storage())
+                    data = table_data {};
+                mock::undo_log().clear();
+            });
+        }
+        return data;
+    }
+
+    name _code;
+    uint64_t _scope;
+    table_data* _data;
+
+    template <size_t I>
+    using index_at = std::tuple_element_t<I, std::tuple<Indices...>>;
+
+    template <name::raw IndexName, size_t I = 0>
+    static constexpr size_t index_position()
+    {
+        if constexpr (I >= sizeof...(Indices)) {
+            static_assert(I < sizeof...(Indices), "name not found in indices");
+            return I;
+        } else if constexpr (index_at<I>::index_name == IndexName) {
+            return I;
+        } else {
+            return index_position<IndexName, I + 1>();
+        }
+    }
+
+    template <size_t... Is>
+    static void insert_keys(table_data& data, const T& obj, std::index_sequence<Is...>)
+    {
+        [[maybe_unused]] uint64_t pk = obj.primary_key();
+        (std::get<Is>(data.indices).emplace(typename index_at<Is>::secondary_extractor_type()(obj), pk, &obj), ...);
+    }
+
+    template <size_t I>
+    void update_key(const key_of<index_at<I>>& old_key, const T& obj)
+    {
+        auto new_key = typename index_at<I>::secondary_extractor_type()(obj);
+        if (new_key == old_key)
+            return;
+        auto& set = std::get<I>(_data->indices);
+        set.erase({ old_key, obj.primary_key() });
+        set.emplace(new_key, obj.primary_key(), &obj);
+    }
+
+    template <size_t... Is>
+    auto extract_keys(const T& obj, std::index_sequence<Is...>)
+    {
+        return std::make_tuple(typename index_at<Is>::secondary_extractor_type()(obj)...);
+    }
+
+    template <typename Keys, size_t... Is>
+    void update_keys(const Keys& old_keys, const T& obj, std::index_sequence<Is...>)
+    {
+        (update_key<Is>(std::get<Is>(old_keys), obj), ...);
+    }
+
+    template <size_t... Is>
+    static void erase_keys(table_data& data, const T& obj, std::index_sequence<Is...>)
+    {
+        [[maybe_unused]] uint64_t pk = obj.primary_key();
+        (std::get<Is>(data.indices).erase({ typename index_at<Is>::secondary_extractor_type()(obj), pk }), ...);
+    }
+
+    // insert a row with its index keys, without any check or journaling
+    static typename std::map<uint64_t, row>::iterator raw_insert(table_data& data, row r)
+    {
+        uint64_t pk = r.value.primary_key();
+
+        auto [itr, ok] = data.rows.emplace(pk, std::move(r));
+        insert_keys(data, itr->second.value, std::index_sequence_for<Indices...>());
+        mock::row_counts()[itr->second.payer.value]++;
+
+        return itr;
+    }
+
+    // erase a row with its index keys, without any check or journaling
+    static void raw_erase(table_data& data, uint64_t pk)
+    {
+        auto found = data.rows.find(pk);
+
+        erase_keys(data, found->second.value, std::index_sequence_for<Indices...>());
+        mock::row_counts()[found->second.payer.value]--;
+        data.rows.erase(found);
+    }
+
+public:
+    typedef T value_type;
+
+    struct const_iterator {
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        typename std::map<uint64_t, row>::const_iterator it;
+
+        const T& operator*() const { return it->second.value; }
+        const T* operator->() const { return &it->second.value; }
+        const_iterator& operator++()
+        {
+            ++it;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            auto tmp = *this;
+            ++it;
+            return tmp;
+        }
+        const_iterator& operator--()
+        {
+            --it;
+            return *this;
+        }
+        const_iterator operator--(int)
+        {
+            auto tmp = *this;
+            --it;
+            return tmp;
+        }
+        friend bool operator==(const const_iterator& a, const const_iterator& b) { return a.it == b.it; }
+        friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a.it != b.it; }
+    };
+
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    template <size_t I>
+    class index {
+    public:
+        using key_type = key_of<index_at<I>>;
+        using set_type = index_set<index_at<I>>;
+
+        struct const_iterator {
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            typename set_type::const_iterator it;
+            const table_data* data;
+
+            const T& operator*() const { return *it->value; }
+            const T* operator->() const { return it->value; }
+            const_iterator& operator++()
+            {
+                ++it;
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++it;
+                return tmp;
+            }
+            const_iterator& operator--()
+            {
+                --it;
+                return *this;
+            }
+            const_iterator operator--(int)
+            {
+                auto tmp = *this;
+                --it;
+                return tmp;
+            }
+            friend bool operator==(const const_iterator& a, const const_iterator& b) { return a.it == b.it; }
+            friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a.it != b.it; }
+        };
+
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+        explicit index(multi_index* mi)
+            : _mi(mi)
+        {
+        }
+
+        const_iterator begin() const { return { set().begin(), _mi->_data }; }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator end() const { return { set().end(), _mi->_data }; }
+        const_iterator cend() const { return end(); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        const_iterator lower_bound(const key_type& k) const { return { set().lower_bound({ k, 0 }), _mi->_data }; }
+        const_iterator upper_bound(const key_type& k) const
+        {
+            return { set().upper_bound({ k, std::numeric_limits<uint64_t>::max() }), _mi->_data };
+        }
+
+        const_iterator find(const key_type& k) const
+        {
+            auto itr = lower_bound(k);
+            if (itr.it == set().end() || itr.it->first != k)
+                return end();
+            return itr;
+        }
+
+        const_iterator require_find(const key_type& k, const char* msg = "unable to find secondary key") const
+        {
+            auto itr = find(k);
+            check(itr != end(), msg);
+            return itr;
+        }
+
+        const T& get(const key_type& k, const char* msg = "unable to find secondary key") const { return *require_find(k, msg); }
+
+        const_iterator iterator_to(const T& obj) const
+        {
+            key_type k = typename index_at<I>::secondary_extractor_type()(obj);
+            return { set().find({ k, obj.primary_key() }), _mi->_data };
+        }
+
+        template <typename Lambda>
+        void modify(const_iterator itr, eosio::name payer, Lambda&& updater)
+        {
+            check(itr != end(), "cannot pass end iterator to modify");
+            _mi->modify(*itr, payer, std::forward<Lambda>(updater));
+        }
+
+        const_iterator erase(const_iterator itr)
+        {
+            check(itr != end(), "cannot pass end iterator to erase");
+            auto next = itr;
+            ++next;
+            _mi->erase(*itr);
+            return next;
+        }
+
+        eosio::name get_code() const { return _mi->get_code(); }
+        uint64_t get_scope() const { return _mi->get_scope(); }
+
+    private:
+        const set_type& set() const { return std::get<I>(_mi->_data->indices); }
+
+        multi_index* _mi;
+    };
+
+    multi_index(name code, uint64_t scope)
+        : _code(code)
+        , _scope(scope)
+        , _data(&storage()[{ code.value, scope }])
+    {
+    }
+
+    name get_code() const { return _code; }
+    uint64_t get_scope() const { return _scope; }
+
+    const_iterator begin() const { return { _data->rows.cbegin() }; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator end() const { return { _data->rows.cend() }; }
+    const_iterator cend() const { return end(); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    const_iterator lower_bound(uint64_t pk) const { return { _data->rows.lower_bound(pk) }; }
+    const_iterator upper_bound(uint64_t pk) const { return { _data->rows.upper_bound(pk) }; }
+
+    uint64_t available_primary_key() const
+    {
+        if (_data->rows.empty())
+            return 0;
+        return _data->rows.rbegin()->first + 1;
+    }
+
+    template <name::raw IndexName>
+    auto get_index()
+    {
+        return index<index_position<IndexName>()>(this);
+    }
+
+    template <name::raw IndexName>
+    auto get_index() const
+    {
+        return index<index_position<IndexName>()>(const_cast<multi_index*>(this));
+    }
+
+    const_iterator iterator_to(const T& obj) const { return { _data->rows.find(obj.primary_key()) }; }
+
+    template <typename Lambda>
+    const_iterator emplace(name payer, Lambda&& constructor)
+    {
+        check(payer.value != 0, "must specify a valid account to pay for new record");
+
+        T obj {};
+        constructor(obj);
+
+        uint64_t pk = obj.primary_key();
+        check(_data->rows.find(pk) == _data->rows.end(), "could not insert object, most likely a uniqueness constraint was violated");
+
+        auto itr = raw_insert(*_data, row { std::move(obj), payer });
+
+        mock::undo_log().push_back([data = _data, pk] { raw_erase(*data, pk); });
+        mock::written_rows().push_back({ _code.value, _scope, uint64_t(TableName), pk });
+
+        return { itr };
+    }
+
+    template <typename Lambda>
+    void modify(const_iterator itr, name payer, Lambda&& updater)
+    {
+        check(itr != end(), "cannot pass end iterator to modify");
+        modify(*itr, payer, std::forward<Lambda>(updater));
+    }
+
+    template <typename Lambda>
+    void modify(const T& obj, name payer, Lambda&& updater)
+    {
+        uint64_t pk = obj.primary_key();
+        auto found = _data->rows.find(pk);
+        check(found != _data->rows.end(), "object passed to modify is not in multi_index");
+
+        row& r = found->second;
+
+        mock::undo_log().push_back([data = _data, old = r] {
+            raw_erase(*data, old.value.primary_key());
+            raw_insert(*data, old);
+        });
+        mock::written_rows().push_back({ _code.value, _scope, uint64_t(TableName), pk });
+
+        auto old_keys = extract_keys(r.value, std::index_sequence_for<Indices...>());
+        updater(r.value);
+        check(r.value.primary_key() == pk, "updater cannot change primary key when modifying an object");
+        update_keys(old_keys, r.value, std::index_sequence_for<Indices...>());
+
+        if (payer.value != 0 && payer != r.payer) {
+            mock::row_counts()[r.payer.value]--;
+            mock::row_counts()[payer.value]++;
+            r.payer = payer;
+        }
+    }
+
+    const T& get(uint64_t pk, const char* msg = "unable to find key") const
+    {
+        auto itr = find(pk);
+        check(itr != end(), msg);
+        return *itr;
+    }
+
+    const_iterator find(uint64_t pk) const { return { _data->rows.find(pk) }; }
+
+    const_iterator require_find(uint64_t pk, const char* msg = "unable to find key") const
+    {
+        auto itr = find(pk);
+        check(itr != end(), msg);
+        return itr;
+    }
+
+    const_iterator erase(const_iterator itr)
+    {
+        check(itr != end(), "cannot pass end iterator to erase");
+        auto next = itr;
+        ++next;
+        erase(*itr);
+        return next;
+    }
+
+    void erase(const T& obj)
+    {
+        uint64_t pk = obj.primary_key();
+        auto found = _data->rows.find(pk);
+        check(found != _data->rows.end(), "object passed to erase is not in multi_index");
+
+        mock::undo_log().push_back([data = _data, old = found->second] { raw_insert(*data, old); });
+        mock::written_rows().push_back({ _code.value, _scope, uint64_t(TableName), pk });
+
+        raw_erase(*_data, pk);
+    }
+
+    // mock-only: payer of a row
+    name payer_of(uint64_t pk) const { return _data->rows.at(pk).payer; }
+};
+
+} // namespace eosio
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "asset.hpp"
+#include "system.hpp"
+
+#include <string>
+#include <type_traits>
+
+namespace eosio {
+
+namespace mock {
+    inline void print_one(const char* s) { env().console += s; }
+    inline void print_one(const std::string& s) { env().console += s; }
+    inline void print_one(const name& n) { env().console += n.to_string(); }
+    inline void print_one(const asset& a) { env().console += a.to_string(); }
+    inline void print_one(bool b) { env().console += b ? "true" : "false"; }
+    inline void print_one(char c) { env().console += c; }
+
+    template <typename T>
+    std::enable_if_t<std::is_arithmetic_v<T>> print_one(T v)
+    {
+        env().console += std::to_string(v);
+    }
+
+    inline void print_one(uint128_t v)
+    {
+        std::string s;
+        do {
+            s.insert(s.begin(), char('0' + int(v % 10)));
+            v /= 10;
+        } while (v > 0);
+        env().console += s;
+    }
+} // namespace mock
+
+template <typename... Args>
+void print(Args&&... args)
+{
+    (mock::print_one(std::forward<Args>(args)), ...);
+}
+
+} // namespace eosio
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "name.hpp"
+
+namespace eosio {
+
+class symbol_code {
+public:
+    constexpr symbol_code() = default;
+    constexpr explicit symbol_code(uint64_t raw)
+        : value(raw)
+    {
+    }
+    constexpr explicit symbol_code(std::string_view str)
+    {
+        if (str.size() > 7)
+            throw eosio_assert_exception("string is too long to be a valid symbol_code");
+        for (auto itr = str.rbegin(); itr != str.rend(); ++itr) {
+            if (*itr < 'A' || *itr > 'Z')
+                throw eosio_assert_exception("only uppercase letters allowed in symbol_code string");
+            value <<= 8;
+            value |= *itr;
+        }
+    }
+
+    constexpr uint64_t raw() const { return value; }
+    constexpr explicit operator bool() const { return value != 0; }
+
+    std::string to_string() const
+    {
+        std::string s;
+        uint64_t v = value;
+        while (v > 0) {
+            s += char(v & 0xFF);
+            v >>= 8;
+        }
+        return s;
+    }
+
+    friend constexpr bool operator==(const symbol_code& a, const symbol_code& b) { return a.value == b.value; }
+    friend constexpr bool operator!=(const symbol_code& a, const symbol_code& b) { return a.value != b.value; }
+    friend constexpr bool operator<(const symbol_code& a, const symbol_code& b) { return a.value < b.value; }
+
+private:
+    uint64_t value = 0;
+};
+
+class symbol {
+public:
+    constexpr symbol() = default;
+    constexpr explicit symbol(uint64_t raw)
+        : value(raw)
+    {
+    }
+    constexpr symbol(symbol_code sc, uint8_t precision)
+        : value((sc.raw() << 8) | precision)
+    {
+    }
+    constexpr symbol(std::string_view ss, uint8_t precision)
+        : value((symbol_code(ss).raw() << 8) | precision)
+    {
+    }
+
+    constexpr bool is_valid() const { return code().raw() != 0; }
+    constexpr uint8_t precision() const { return value & 0xFF; }
+    constexpr symbol_code code() const { return symbol_code(value >> 8); }
+    constexpr uint64_t raw() const { return value; }
+    constexpr explicit operator bool() const { return value != 0; }
+
+    friend constexpr bool operator==(const symbol& a, const symbol& b) { return a.value == b.value; }
+    friend constexpr bool operator!=(const symbol& a, const symbol& b) { return a.value != b.value; }
+    friend constexpr bool operator<(const symbol& a, const symbol& b) { return a.value < b.value; }
+
+private:
+    uint64_t value = 0;
+};
+
+class extended_symbol {
+public:
+    constexpr extended_symbol() = default;
+    constexpr extended_symbol(symbol s, name con)
+        : sym(s)
+        , contract(con)
+    {
+    }
+
+    constexpr symbol get_symbol() const { return sym; }
+    constexpr name get_contract() const { return contract; }
+
+    friend constexpr bool operator==(const extended_symbol& a, const extended_symbol& b)
+    {
+        return a.sym == b.sym && a.contract == b.contract;
+    }
+    friend constexpr bool operator!=(const extended_symbol& a, const extended_symbol& b) { return !(a == b); }
+    friend constexpr bool operator<(const extended_symbol& a, const extended_symbol& b)
+    {
+        return a.contract < b.contract || (a.contract == b.contract && a.sym < b.sym);
+    }
+
+    symbol sym;
+    name contract;
+};
+
+} // namespace eosio
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "name.hpp"
+#include "time.hpp"
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace eosio {
+
+namespace mock {
+    struct environment {
+        time_point now;
+        std::set<uint64_t> auths;
+        std::set<uint64_t> accounts;
+        std::vector<name> recipients;
+        std::string console;
+    };
+
+    inline environment& env()
+    {
+        static environment e;
+        return e;
+    }
+} // namespace mock
+
+inline time_point current_time_point() { return mock::env().now; }
+inline time_point_sec current_block_time() { return time_point_sec(mock::env().now); }
+
+inline bool has_auth(name n) { return mock::env().auths.count(n.value) > 0; }
+inline void require_auth(name n) { check(has_auth(n), "missing authority of " + n.to_string()); }
+inline bool is_account(name n) { return mock::env().accounts.count(n.value) > 0; }
+inline void require_recipient(name n) { mock::env().recipients.push_back(n); }
+
+} // namespace eosio
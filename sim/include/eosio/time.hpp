@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+namespace eosio {
+
+class microseconds {
+public:
+    explicit constexpr microseconds(int64_t c = 0)
+        : _count(c)
+    {
+    }
+    constexpr int64_t count() const { return _count; }
+    constexpr int64_t to_seconds() const { return _count / 1000000; }
+
+    friend constexpr bool operator==(const microseconds& a, const microseconds& b) { return a._count == b._count; }
+    friend constexpr bool operator<(const microseconds& a, const microseconds& b) { return a._count < b._count; }
+    friend constexpr microseconds operator+(const microseconds& a, const microseconds& b) { return microseconds(a._count + b._count); }
+    friend constexpr microseconds operator-(const microseconds& a, const microseconds& b) { return microseconds(a._count - b._count); }
+
+    int64_t _count;
+};
+
+inline constexpr microseconds seconds(int64_t s) { return microseconds(s * 1000000); }
+inline constexpr microseconds minutes(int64_t m) { return seconds(60 * m); }
+inline constexpr microseconds hours(int64_t h) { return minutes(60 * h); }
+inline constexpr microseconds days(int64_t d) { return hours(24 * d); }
+
+class time_point {
+public:
+    explicit constexpr time_point(microseconds e = microseconds())
+        : elapsed(e)
+    {
+    }
+    constexpr const microseconds& time_since_epoch() const { return elapsed; }
+    constexpr uint32_t sec_since_epoch() const { return uint32_t(elapsed.count() / 1000000); }
+
+    friend constexpr bool operator<(const time_point& a, const time_point& b) { return a.elapsed < b.elapsed; }
+    friend constexpr bool operator==(const time_point& a, const time_point& b) { return a.elapsed == b.elapsed; }
+    friend constexpr time_point operator+(const time_point& a, const microseconds& b) { return time_point(a.elapsed + b); }
+    friend constexpr microseconds operator-(const time_point& a, const time_point& b) { return a.elapsed - b.elapsed; }
+
+    microseconds elapsed;
+};
+
+class time_point_sec {
+public:
+    constexpr time_point_sec()
+        : utc_seconds(0)
+    {
+    }
+    constexpr explicit time_point_sec(uint32_t seconds)
+        : utc_seconds(seconds)
+    {
+    }
+    constexpr time_point_sec(const time_point& t)
+        : utc_seconds(t.sec_since_epoch())
+    {
+    }
+
+    static constexpr time_point_sec maximum() { return time_point_sec(0xffffffff); }
+    static constexpr time_point_sec min() { return time_point_sec(0); }
+
+    constexpr operator time_point() const { return time_point(eosio::seconds(utc_seconds)); }
+    constexpr uint32_t sec_since_epoch() const { return utc_seconds; }
+
+    friend constexpr bool operator<(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds < b.utc_seconds; }
+    friend constexpr bool operator<=(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds <= b.utc_seconds; }
+    friend constexpr bool operator>(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds > b.utc_seconds; }
+    friend constexpr bool operator>=(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds >= b.utc_seconds; }
+    friend constexpr bool operator==(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds == b.utc_seconds; }
+    friend constexpr bool operator!=(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds != b.utc_seconds; }
+    friend constexpr time_point_sec operator+(const time_point_sec& a, uint32_t s) { return time_point_sec(a.utc_seconds + s); }
+    friend constexpr time_point_sec operator-(const time_point_sec& a, uint32_t s) { return time_point_sec(a.utc_seconds - s); }
+
+    uint32_t utc_seconds;
+};
+
+} // namespace eosio
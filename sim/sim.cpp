@@ -0,0 +1,455 @@
+// randomized stake/claim/unstake/rate-change workload against the host-native ezstake contract
+// with template removals, set boosts and extra tokens along the way
+// checks the accounting invariants along the way and reports the throughput
+
+#include "chain.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <regex>
+
+namespace {
+
+struct options {
+    uint32_t users = 1000;
+    uint32_t assets = 50;
+    uint32_t templates = 8;
+    uint64_t ops = 200000;
+    uint64_t check_every = 20000;
+    uint8_t reward_mode = ezstake::ACCRUAL;
+    uint8_t storage_mode = ezstake::ROWS;
+    uint32_t seed = 1;
+    // where to dump the table deltas, for the indexer
+    std::string deltas;
+};
+
+enum op_t : uint8_t {
+    STAKE,
+    CLAIM,
+    UNSTAKE,
+    SET_RATE,
+    RM_TEMPLATE,
+    RERATE,
+    RESET,
+    CRANK,
+    SET_BOOST,
+    SET_EXTRAS,
+    OP_COUNT,
+};
+
+const char* OP_NAMES[OP_COUNT] = { "stake", "claim", "unstake", "setrate", "rmtemplate", "rerate", "reset", "crank", "setboost", "setextras" };
+
+// the chance of each operation, out of 100
+const uint32_t OP_WEIGHTS[OP_COUNT] = { 31, 28, 27, 2, 1, 7, 1, 1, 1, 1 };
+
+struct user_state {
+    name user;
+    bool registered = false;
+    std::vector<uint64_t> owned;
+    std::vector<uint64_t> staked;
+};
+
+struct op_stats {
+    uint64_t ok = 0;
+    uint64_t rejected = 0;
+    double seconds = 0;
+    std::map<std::string, uint64_t> reasons;
+};
+
+void usage()
+{
+    std::cerr << "usage: sim [--users N] [--assets N] [--templates N] [--ops N] [--check N]\n"
+                 "           [--mode per-asset|accrual|pool] [--storage rows|buckets] [--seed N] [--deltas FILE]\n";
+    std::exit(2);
+}
+
+options parse_options(int argc, char** argv)
+{
+    options opts;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (i + 1 >= argc) {
+            usage();
+        }
+
+        const std::string value = argv[++i];
+
+        if (arg == "--users") {
+            opts.users = std::stoul(value);
+        } else if (arg == "--assets") {
+            opts.assets = std::stoul(value);
+        } else if (arg == "--templates") {
+            opts.templates = std::stoul(value);
+        } else if (arg == "--ops") {
+            opts.ops = std::stoull(value);
+        } else if (arg == "--check") {
+            opts.check_every = std::stoull(value);
+        } else if (arg == "--seed") {
+            opts.seed = std::stoul(value);
+        } else if (arg == "--mode") {
+            opts.reward_mode = value == "per-asset" ? ezstake::PER_ASSET : value == "pool" ? ezstake::POOL : ezstake::ACCRUAL;
+        } else if (arg == "--storage") {
+            opts.storage_mode = value == "buckets" ? ezstake::BUCKETS : ezstake::ROWS;
+        } else if (arg == "--deltas") {
+            opts.deltas = value;
+        } else {
+            usage();
+        }
+    }
+
+    if (opts.templates == 0 || opts.users == 0) {
+        usage();
+    }
+
+    return opts;
+}
+
+// a valid account name for the i-th simulated user
+name user_name(uint32_t index)
+{
+    std::string str = "sim";
+
+    for (int i = 0; i < 6; i++) {
+        str += char('a' + index % 26);
+        index /= 26;
+    }
+
+    return name(str);
+}
+
+// group the assert messages that only differ by their asset id, template id or user
+// the numeric error codes (see ezstake::error_code_t) are grouped by their error, without the id
+std::string reason_of(const std::string& error)
+{
+    static const std::regex ids("\\([0-9]+\\)");
+    static const std::regex users("(^| )user [a-z1-5.]+");
+    static const std::string code_prefix = "error code ";
+
+    if (error.rfind(code_prefix, 0) == 0) {
+        return code_prefix + std::to_string(std::stoull(error.substr(code_prefix.size())) >> 48) + " (id)";
+    }
+
+    return std::regex_replace(std::regex_replace(error, ids, "(id)"), users, "$1user <user>");
+}
+
+// take up to `count` random items out of `from`
+std::vector<uint64_t> pick(std::mt19937_64& rng, const std::vector<uint64_t>& from, const size_t& count)
+{
+    std::vector<uint64_t> picked = from;
+
+    std::shuffle(picked.begin(), picked.end(), rng);
+    picked.resize(std::min(count, picked.size()));
+
+    return picked;
+}
+
+// move the `ids` from one list to the other
+void move_ids(std::vector<uint64_t>& from, std::vector<uint64_t>& to, const std::vector<uint64_t>& ids)
+{
+    for (const uint64_t& id : ids) {
+        from.erase(std::find(from.begin(), from.end(), id));
+        to.push_back(id);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const options opts = parse_options(argc, argv);
+
+    std::mt19937_64 rng(opts.seed);
+    ezstake_sim chain;
+
+    const name admin = chain.self;
+    const symbol wax = symbol(symbol_code("WAX"), 8);
+
+    auto require = [](const std::string& error, const char* what) {
+        if (!error.empty()) {
+            std::cerr << what << " failed: " << error << "\n";
+            std::exit(1);
+        }
+    };
+
+    // dump the table deltas of every committed transaction (the op timings then include the dump)
+    std::unique_ptr<deltas::writer> delta_writer;
+
+    if (!opts.deltas.empty()) {
+        delta_writer = std::make_unique<deltas::writer>(opts.deltas);
+        chain.delta_writer = delta_writer.get();
+    }
+
+    // configure the contract
+    chain.reset(1640995200);
+
+#if FIXED_CONFIG
+    // the token and the periods are baked in, the config row is saved by the first admin action
+#else
+    require(chain.push(admin, [](ezstake& c) { c.setconfig(600, 3600); }), "setconfig");
+#endif
+
+    // nothing was staked by an older version, so the actions can walk the ownerasset index right away
+    require(chain.push(admin, [](ezstake& c) { c.backfill(0, 1); }), "backfill");
+
+    if (opts.reward_mode != ezstake::PER_ASSET) {
+        require(chain.push(admin, [&](ezstake& c) { c.setmode(opts.reward_mode); }), "setmode");
+    }
+
+    if (opts.reward_mode == ezstake::POOL) {
+        require(chain.push(admin, [&](ezstake& c) { c.setemission(asset(1000 * 100000000LL, wax)); }), "setemission");
+    }
+
+    // the crank pays out the users above 1 token (per-user modes)
+    if (opts.reward_mode != ezstake::PER_ASSET) {
+        require(chain.push(admin, [&](ezstake& c) { c.setpayout(asset(100000000LL, wax)); }), "setpayout");
+    }
+
+    if (opts.storage_mode == ezstake::BUCKETS) {
+        require(chain.push(admin, [&](ezstake& c) { c.setstorage(opts.storage_mode); }), "setstorage");
+    }
+
+    auto random_rate = [&]() { return asset(int64_t(1 + rng() % 10) * 100000000, wax); };
+
+    std::vector<ezstake::template_item> templates = {};
+
+    for (uint32_t i = 1; i <= opts.templates; i++) {
+        chain.create_template(int32_t(i));
+        templates.push_back({ int32_t(i), chain.collection, random_rate() });
+    }
+
+    require(chain.push(admin, [&](ezstake& c) { c.addtemplates(templates); }), "addtemplates");
+
+    // mint the users' assets
+    std::vector<user_state> users(opts.users);
+
+    for (uint32_t i = 0; i < opts.users; i++) {
+        users[i].user = user_name(i);
+
+        for (uint32_t j = 0; j < opts.assets; j++) {
+            users[i].owned.push_back(chain.mint(users[i].user, int32_t(1 + rng() % opts.templates)));
+        }
+    }
+
+    std::cout << "ezstake sim: " << opts.users << " users, " << opts.assets << " assets each, " << opts.templates << " templates, "
+              << (opts.reward_mode == ezstake::PER_ASSET ? "per-asset" : opts.reward_mode == ezstake::POOL ? "pool" : "accrual") << " mode, "
+              << (opts.storage_mode == ezstake::BUCKETS ? "buckets" : "rows") << " storage, seed " << opts.seed << "\n";
+
+    op_stats stats[OP_COUNT];
+    std::map<int32_t, name> rerate_cursors = {};
+    uint64_t next_set_id = 1;
+
+    uint64_t checks = 0;
+    double check_seconds = 0;
+
+    auto check_invariants = [&](const uint64_t& op) {
+        const auto start = std::chrono::steady_clock::now();
+        const std::string violation = chain.check_invariants();
+
+        check_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        checks++;
+
+        if (!violation.empty()) {
+            std::cerr << "invariant violated after op " << op << ": " << violation << "\n";
+            std::exit(1);
+        }
+    };
+
+    for (uint64_t op = 1; op <= opts.ops; op++) {
+        // advance the chain by up to a minute
+        chain.set_time(chain.now() + uint32_t(rng() % 61));
+
+        uint32_t roll = rng() % 100;
+        uint8_t type = 0;
+
+        while (roll >= OP_WEIGHTS[type]) {
+            roll -= OP_WEIGHTS[type++];
+        }
+
+        user_state& state = users[rng() % users.size()];
+        const name user = state.user;
+
+        std::string error;
+        const auto start = std::chrono::steady_clock::now();
+
+        // the users register on their first action
+        if (!state.registered && (type == STAKE || type == CLAIM || type == UNSTAKE)) {
+            require(chain.push(user, [&](ezstake& c) { c.regnewuser(user); }), "regnewuser");
+            state.registered = true;
+        }
+
+        switch (type) {
+        case STAKE: {
+            const auto ids = pick(rng, state.owned, 1 + rng() % 20);
+
+            error = ids.empty() ? "skipped: no assets to stake" : chain.stake(user, ids);
+
+            if (error.empty()) {
+                move_ids(state.owned, state.staked, ids);
+            }
+            break;
+        }
+        case CLAIM:
+            error = chain.push(user, [&](ezstake& c) { c.claimall(user, 0, 100); });
+            break;
+        case UNSTAKE: {
+            const auto ids = pick(rng, state.staked, 1 + rng() % 20);
+
+            error = ids.empty() ? "skipped: no assets to unstake" : chain.push(user, [&](ezstake& c) { c.unstake(user, ids); });
+
+            if (error.empty()) {
+                move_ids(state.staked, state.owned, ids);
+            }
+            break;
+        }
+        case SET_RATE: {
+            const ezstake::template_item item = { int32_t(1 + rng() % opts.templates), chain.collection, random_rate() };
+
+            error = chain.push(admin, [&](ezstake& c) { c.addtemplates({ item }); });
+            break;
+        }
+        case RM_TEMPLATE: {
+            ezstake_sim::template_t template_tbl(chain.self, chain.self.value);
+
+            int32_t removed = 0;
+
+            for (uint32_t i = 1; i <= opts.templates && removed == 0; i++) {
+                removed = template_tbl.find(i) == template_tbl.end() ? int32_t(i) : 0;
+            }
+
+            // add back the removed template (once re-rated) or remove a random one
+            if (removed != 0) {
+                const ezstake::template_item item = { removed, chain.collection, random_rate() };
+
+                error = chain.push(admin, [&](ezstake& c) { c.addtemplates({ item }); });
+            } else {
+                const ezstake::template_item item = { int32_t(1 + rng() % opts.templates), chain.collection, asset(0, wax) };
+
+                error = chain.push(admin, [&](ezstake& c) { c.rmtemplates({ item }); });
+            }
+            break;
+        }
+        case RERATE: {
+            ezstake_sim::rerate_t rerate_tbl(chain.self, chain.self.value);
+
+            if (rerate_tbl.begin() == rerate_tbl.end()) {
+                error = "skipped: no pending re-rate";
+                break;
+            }
+
+            const int32_t template_id = rerate_tbl.begin()->template_id;
+
+            error = chain.push(admin, [&](ezstake& c) { c.rerate(template_id, rerate_cursors[template_id], 100); });
+
+            // resume from the printed cursor
+            const std::string& console = mock::env().console;
+
+            if (error.empty() && console.rfind("next: ", 0) == 0) {
+                rerate_cursors[template_id] = name(console.substr(6));
+            } else if (error.empty()) {
+                rerate_cursors.erase(template_id);
+            }
+            break;
+        }
+        case RESET:
+            error = chain.push(admin, [&](ezstake& c) { c.resetuser(user); });
+
+            if (error.empty()) {
+                move_ids(state.staked, state.owned, std::vector<uint64_t>(state.staked));
+                state.registered = false;
+            }
+            break;
+        case CRANK:
+            error = chain.push(user, [&](ezstake& c) { c.crank(100); });
+            break;
+        case SET_BOOST: {
+            ezstake_sim::set_t set_tbl(chain.self, chain.self.value);
+
+            // remove the oldest set (a batch of its users at a time) or add a set of 2 random templates
+            // a set takes a few rmset calls to go, so the live sets are capped to one per template like a real collection
+            const bool is_full = std::distance(set_tbl.begin(), set_tbl.end()) >= std::ptrdiff_t(opts.templates);
+
+            if (set_tbl.begin() != set_tbl.end() && (is_full || rng() % 2 == 0)) {
+                const uint64_t set_id = set_tbl.begin()->set_id;
+
+                error = chain.push(admin, [&](ezstake& c) { c.rmset(set_id, 100); });
+            } else {
+                const int32_t first = int32_t(1 + rng() % opts.templates);
+                const int32_t second = int32_t(1 + (first + rng() % std::max(opts.templates - 1, 1u)) % opts.templates);
+                const uint64_t set_id = next_set_id++;
+
+                error = chain.push(admin, [&](ezstake& c) { c.addset(set_id, { first, second }, uint16_t(1 + rng() % 5000)); });
+            }
+            break;
+        }
+        case SET_EXTRAS: {
+            // give a template an extra token rate, or take its extra tokens away
+            const int32_t template_id = int32_t(1 + rng() % opts.templates);
+            std::vector<extended_asset> extra_rates = {};
+
+            if (rng() % 3 != 0) {
+                extra_rates.push_back(extended_asset(asset(int64_t(1 + rng() % 10) * 10000, symbol(symbol_code("BTC"), 4)), name("test.token")));
+            }
+
+            error = chain.push(admin, [&](ezstake& c) { c.setextras(template_id, extra_rates); });
+            break;
+        }
+        }
+
+        op_stats& op_stat = stats[type];
+
+        op_stat.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (error.empty()) {
+            op_stat.ok++;
+        } else {
+            op_stat.rejected++;
+            op_stat.reasons[reason_of(error)]++;
+        }
+
+        if (opts.check_every > 0 && op % opts.check_every == 0) {
+            check_invariants(op);
+        }
+    }
+
+    check_invariants(opts.ops);
+
+    // report
+    double total_seconds = 0;
+
+    for (uint8_t type = 0; type < OP_COUNT; type++) {
+        const op_stats& op_stat = stats[type];
+        const uint64_t count = op_stat.ok + op_stat.rejected;
+
+        total_seconds += op_stat.seconds;
+
+        std::cout << "  " << OP_NAMES[type] << ": " << op_stat.ok << " ok, " << op_stat.rejected << " rejected";
+
+        if (count > 0) {
+            std::cout << ", " << uint64_t(count / std::max(op_stat.seconds, 1e-9)) << " ops/sec";
+        }
+
+        std::cout << "\n";
+
+        for (const auto& [reason, times] : op_stat.reasons) {
+            std::cout << "    " << times << "x " << reason << "\n";
+        }
+    }
+
+    std::cout << "total: " << opts.ops << " ops in " << total_seconds << "s, " << uint64_t(opts.ops / std::max(total_seconds, 1e-9)) << " ops/sec\n";
+    std::cout << "invariants: " << checks << " checks in " << check_seconds << "s, ok\n";
+
+    // the indexer should find the same pending rewards from the dump
+    if (delta_writer != nullptr) {
+        std::cout << "deltas: " << delta_writer->records() << " records in " << chain.block_num << " blocks written to " << opts.deltas
+                  << ", pending " << asset(chain.total_pending(), wax).to_string() << " at " << chain.now() << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+import { TimePointSec } from "@greymass/eosio";
+import { Blockchain } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("backfill", () => {
+	describe("backfill assets", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake some assets for alice
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.backfill([0, 100]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow zero limit", () => {
+			return assert.isRejected(ezstakeContract.actions.backfill([0, 0]).send(), "limit must be positive");
+		});
+
+		it("backfill the assets", () => {
+			return assert.isFulfilled(ezstakeContract.actions.backfill([0, 100]).send());
+		});
+
+		describe("table storage", () => {
+			it("keep cached rows", async () => {
+				await ezstakeContract.actions.backfill([0, 1]).send();
+				await ezstakeContract.actions.backfill(["1099511627777", 1]).send();
+
+				const assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					assets.map((row) => row.value),
+					[
+						{
+							asset_id: "1099511627776",
+							owner: "alice",
+							last_claim: "2022-01-01T00:00:00",
+							template_id: 1,
+							collection: "dummycol",
+						},
+						{
+							asset_id: "1099511627777",
+							owner: "alice",
+							last_claim: "2022-01-01T00:00:00",
+							template_id: 1,
+							collection: "dummycol",
+						},
+					]
+				);
+			});
+
+			it("switch to the ownerasset index once done", async () => {
+				const [config] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "config", ezstakeContract.name.toString());
+
+				assert.equal(config.value.is_indexed, true);
+			});
+		});
+	});
+});
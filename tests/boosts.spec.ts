@@ -0,0 +1,181 @@
+import { Asset, Name, TimePointSec, UInt64 } from "@greymass/eosio";
+import { Blockchain, mintTokens, nameToBigInt, symbolCodeToBigInt } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const eosioTokenContract = blockchain.createContract("eosio.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("boosts", () => {
+	describe("set boosts", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// mint 2 assets from template 2 to alice
+			for (let i = 0; i < 2; i++) {
+				await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 2, "alice", [], [], []]).send("dummycol@active");
+			}
+
+			// set staking templates
+			await ezstakeContract.actions
+				.addtemplates([
+					[
+						{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" },
+						{ template_id: 2, collection: "dummycol", hourly_rate: "1.00000000 WAX" },
+					],
+				])
+				.send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.addset([1, [1, 2], 5000]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow in per-asset mode", () => {
+			return assert.isRejected(ezstakeContract.actions.addset([1, [1, 2], 5000]).send(), "set boosts require a per-user reward mode");
+		});
+
+		it("disallow duplicated templates", async () => {
+			await ezstakeContract.actions.setmode([1]).send();
+
+			return assert.isRejected(ezstakeContract.actions.addset([1, [1, 1], 5000]).send(), "template listed more than once");
+		});
+
+		it("boost the complete sets", async () => {
+			await ezstakeContract.actions.addset([1, [1, 2], 5000]).send();
+
+			// stake 2 assets from template 1 and 1 from template 2
+			return assert.isFulfilled(
+				atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777", "1099511627784"], "stake"]).send("alice@active")
+			);
+		});
+
+		describe("table storage", () => {
+			it("add the boost to the user's rate", () => {
+				const [user] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+
+				assert.equal(user.value.hourly_rate, "4.00000000 WAX");
+			});
+
+			it("count the complete sets", () => {
+				const [boost] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "boosts", ezstakeContract.name.toString());
+
+				assert.deepEqual(boost.value, { id: "0", user: "alice", set_id: "1", complete: "1", bonus_rate: "1.00000000 WAX" });
+			});
+
+			it("link the templates to the set", () => {
+				const [link] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "setlinks", Name.from(UInt64.from(2)).toString());
+
+				assert.deepEqual(link.value, { set_id: "1" });
+			});
+		});
+
+		describe("set removal", () => {
+			it("disallow zero max_rows", () => {
+				return assert.isRejected(ezstakeContract.actions.rmset([1, 0]).send(), "max_rows must be positive");
+			});
+
+			it("take the boost out of the user's rate", async () => {
+				await ezstakeContract.actions.rmset([1, 100]).send();
+
+				const [user] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+				const boosts = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "boosts", ezstakeContract.name.toString());
+				const sets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "sets", ezstakeContract.name.toString());
+
+				assert.equal(user.value.hourly_rate, "3.00000000 WAX");
+				assert.isEmpty(boosts);
+				assert.isEmpty(sets);
+			});
+
+			it("leave no rate after a full unstake", async () => {
+				// after the unstaking period
+				blockchain.setTime(TimePointSec.fromString("2022-01-04T00:00:00"));
+
+				await ezstakeContract.actions.unstake(["alice", ["1099511627776", "1099511627777", "1099511627784"]]).send("alice@active");
+
+				const [user] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+
+				assert.equal(user.value.hourly_rate, "0.00000000 WAX");
+			});
+		});
+	});
+});
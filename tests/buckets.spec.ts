@@ -0,0 +1,275 @@
+import { TimePointSec } from "@greymass/eosio";
+import { Blockchain, nameToBigInt } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("buckets", () => {
+	describe("set storage", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.setstorage([1]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow invalid mode", () => {
+			return assert.isRejected(ezstakeContract.actions.setstorage([2]).send(), "invalid storage mode");
+		});
+
+		it("require a per-user reward mode", () => {
+			return assert.isRejected(ezstakeContract.actions.setstorage([1]).send(), "bucket storage requires a per-user reward mode");
+		});
+
+		it("set bucket storage", async () => {
+			await ezstakeContract.actions.setmode([1]).send();
+
+			return assert.isFulfilled(ezstakeContract.actions.setstorage([1]).send());
+		});
+
+		it("disallow setting the same mode", () => {
+			return assert.isRejected(ezstakeContract.actions.setstorage([1]).send(), "storage mode is already set");
+		});
+
+		it("disallow the per-asset mode", () => {
+			return assert.isRejected(ezstakeContract.actions.setmode([0]).send(), "bucket storage requires a per-user reward mode");
+		});
+	});
+
+	describe("stake into buckets", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+			await ezstakeContract.actions.setmode([1]).send();
+			await ezstakeContract.actions.setstorage([1]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake some assets for alice
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627778", "1099511627776", "1099511627777"], "stake"]).send("alice@active");
+		});
+
+		it("disallow unstaking another user's asset", () => {
+			blockchain.addTime(TimePointSec.fromInteger(259200));
+
+			return assert.isRejected(ezstakeContract.actions.unstake(["alice", ["1099511627780"]]).send("alice@active"), "asset (1099511627780) is not staked");
+		});
+
+		it("unstake from a bucket", () => {
+			return assert.isFulfilled(ezstakeContract.actions.unstake(["alice", ["1099511627777"]]).send("alice@active"));
+		});
+
+		describe("table storage", () => {
+			it("pack the assets sorted in one bucket", () => {
+				const buckets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "buckets", ezstakeContract.name.toString());
+
+				assert.deepEqual(buckets, [
+					{
+						primaryKey: BigInt(0),
+						payer: "ezstake",
+						value: {
+							id: "0",
+							owner: "alice",
+							lo_id: "0",
+							entries: [
+								{ asset_id: "1099511627776", slot: 0, time: 1640995200 },
+								{ asset_id: "1099511627778", slot: 0, time: 1640995200 },
+							],
+						},
+						secondaryIndexes: [
+							{
+								type: "idx128",
+								value: nameToBigInt("alice") << 64n,
+							},
+						],
+					},
+				]);
+			});
+
+			it("assign a slot to the template", () => {
+				const slots = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "slots", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					slots.map((row) => row.value),
+					[{ slot: "0", template_id: 1 }]
+				);
+			});
+
+			it("leave the assets table empty", () => {
+				const assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(assets, []);
+			});
+		});
+	});
+
+	describe("pack assets", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice & bob
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake some assets in the assets table
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+			await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780"], "stake"]).send("bob@active");
+
+			await ezstakeContract.actions.setmode([1]).send();
+		});
+
+		it("require the contract to be frozen", () => {
+			return assert.isRejected(ezstakeContract.actions.setstorage([1]).send(), "contract must be frozen to pack the staked assets");
+		});
+
+		it("require the bucket storage", () => {
+			return assert.isRejected(ezstakeContract.actions.packassets([100]).send(), "storage mode is not buckets");
+		});
+
+		it("require packing before unfreezing", async () => {
+			await ezstakeContract.actions.setfrozen([true]).send();
+			await ezstakeContract.actions.setstorage([1]).send();
+
+			return assert.isRejected(ezstakeContract.actions.setfrozen([false]).send(), "staked assets must be packed before unfreezing");
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.packassets([100]).send("alice@active"), "this action is admin only");
+		});
+
+		it("pack the assets", async () => {
+			await ezstakeContract.actions.packassets([2]).send();
+			await ezstakeContract.actions.packassets([2]).send();
+
+			return assert.isFulfilled(ezstakeContract.actions.setfrozen([false]).send());
+		});
+
+		describe("table storage", () => {
+			it("move the rows into the owners' buckets", () => {
+				const assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+				const buckets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "buckets", ezstakeContract.name.toString());
+
+				assert.deepEqual(assets, []);
+				assert.deepEqual(
+					buckets.map((row) => row.value),
+					[
+						{
+							id: "0",
+							owner: "alice",
+							lo_id: "0",
+							entries: [
+								{ asset_id: "1099511627776", slot: 0, time: 1640995200 },
+								{ asset_id: "1099511627777", slot: 0, time: 1640995200 },
+							],
+						},
+						{
+							id: "1",
+							owner: "bob",
+							lo_id: "0",
+							entries: [{ asset_id: "1099511627780", slot: 0, time: 1640995200 }],
+						},
+					]
+				);
+			});
+		});
+	});
+});
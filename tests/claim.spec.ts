@@ -1,4 +1,4 @@
-import { Asset, TimePointSec } from "@greymass/eosio";
+import { Asset, Name, TimePointSec, UInt64 } from "@greymass/eosio";
 import { Blockchain, mintTokens, nameToBigInt, symbolCodeToBigInt } from "@proton/vert";
 import chai, { assert } from "chai";
 import chaiAsPromised from "chai-as-promised";
@@ -15,6 +15,13 @@ function getTableRows<T>(blockchain: Blockchain, code: string, table: string, sc
 	return blockchain.getStorage()[code][table][scope];
 }
 
+// the payloads of the log actions sent by the last transaction
+function getLogs(action: string) {
+	return blockchain.actionTraces
+		.filter((trace) => trace.contract.toString() === "ezstake" && trace.action.toString() === action)
+		.map((trace) => JSON.parse(JSON.stringify(trace.decodedData)));
+}
+
 async function createDummyCollection() {
 	await atomicassetsContract.actions.init().send();
 	await atomicassetsContract.actions
@@ -124,6 +131,13 @@ describe("claim", () => {
 			);
 		});
 
+		it("disallow duplicated assets", () => {
+			return assert.isRejected(
+				ezstakeContract.actions.claim(["alice", ["1099511627776", "1099511627776"]]).send("alice@active"),
+				"asset (1099511627776) is listed more than once"
+			);
+		});
+
 		it("disallow empty claim", () => {
 			// set blockchain time
 			// 10 minutes after staking with very low rate should yield 0 less tokens than the token's native precision
@@ -138,6 +152,12 @@ describe("claim", () => {
 			return assert.isFulfilled(ezstakeContract.actions.claim(["alice", ["1099511627776"]]).send("alice@active"));
 		});
 
+		it("log the claim", () => {
+			assert.deepEqual(getLogs("logclaim"), [
+				{ user: "alice", asset_ids: ["1099511627776"], claimed: "0.00000010 WAX", hourly_rate: "0.00000001 WAX", total_power: "2" },
+			]);
+		});
+
 		it("disallow while in cooldown", () => {
 			// set blockchain time
 			// 5 seconds after last cooldown
@@ -200,12 +220,442 @@ describe("claim", () => {
 				assert.deepEqual(assets, [
 					{
 						primaryKey: 1099511627776n,
-						payer: "alice",
-						value: { asset_id: "1099511627776", owner: "alice", last_claim: "2022-01-01T01:00:00" },
-						secondaryIndexes: [{ type: "idxu64", value: nameToBigInt("alice") }],
+						payer: ezstakeContract.name.toString(),
+						value: {
+							asset_id: "1099511627776",
+							owner: "alice",
+							last_claim: "2022-01-01T01:00:00",
+							template_id: 1,
+							collection: "dummycol",
+						},
+						secondaryIndexes: [
+							{ type: "idxu64", value: nameToBigInt("alice") },
+							{ type: "idx128", value: (nameToBigInt("alice") << 64n) | 1099511627776n },
+						],
 					},
 				]);
 			});
 		});
 	});
+
+	describe("accrual mode", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+			await ezstakeContract.actions.setmode([1]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// stake some assets for alice
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+		});
+
+		it("claim tokens", async () => {
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+			return assert.isFulfilled(ezstakeContract.actions.claim(["alice", []]).send("alice@active"));
+		});
+
+		it("log the claim", () => {
+			// the per-user modes don't list the assets
+			assert.deepEqual(getLogs("logclaim"), [
+				{ user: "alice", asset_ids: [], claimed: "2.00000000 WAX", hourly_rate: "2.00000000 WAX", total_power: "200000000" },
+			]);
+		});
+
+		it("disallow while in cooldown", () => {
+			// set blockchain time
+			// 5 seconds after last claim
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:05"));
+
+			return assert.isRejected(ezstakeContract.actions.claim(["alice", []]).send("alice@active"), "user alice is still in cooldown");
+		});
+
+		describe("table storage", () => {
+			it("update row", async () => {
+				// set blockchain time for claiming
+				blockchain.setTime(TimePointSec.fromString("2022-01-01T02:00:00"));
+
+				await ezstakeContract.actions.claim(["alice", []]).send("alice@active");
+
+				const [balance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+				const [user] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+				const assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(balance.value, { balance: "4.00000000 WAX" });
+
+				assert.deepEqual(user.value, {
+					user: "alice",
+					hourly_rate: "2.00000000 WAX",
+					accrued: "0.00000000 WAX",
+					last_update: "2022-01-01T02:00:00",
+					last_claim: "2022-01-01T02:00:00",
+					reward_debt: "0",
+					mode_switch: 1,
+				});
+
+				// the staked assets are left untouched
+				assert.deepEqual(
+					assets.map((row) => [row.payer, row.value.last_claim]),
+					[
+						[ezstakeContract.name.toString(), "2022-01-01T00:00:00"],
+						[ezstakeContract.name.toString(), "2022-01-01T00:00:00"],
+					]
+				);
+			});
+		});
+	});
+
+	describe("claim all assets", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake some assets for alice
+			await atomicassetsContract.actions
+				.transfer(["alice", "ezstake", ["1099511627776", "1099511627777", "1099511627778"], "stake"])
+				.send("alice@active");
+		});
+
+		it("require user auth", () => {
+			return assert.isRejected(
+				ezstakeContract.actions.claimall(["alice", 0, 10]).send("bob@active"),
+				"user alice has not authorized this action"
+			);
+		});
+
+		it("disallow zero max_rows", () => {
+			return assert.isRejected(ezstakeContract.actions.claimall(["alice", 0, 0]).send("alice@active"), "max_rows must be positive");
+		});
+
+		it("disallow non registered", () => {
+			return assert.isRejected(ezstakeContract.actions.claimall(["clark", 0, 10]).send("clark@active"), "user clark is not registered");
+		});
+
+		describe("table storage", () => {
+			it("update rows in batches", async () => {
+				// set blockchain time for claiming
+				blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+				await ezstakeContract.actions.claimall(["alice", 0, 2]).send("alice@active");
+
+				const [balance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+				let assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(balance.value, { balance: "2.00000000 WAX" });
+				assert.deepEqual(
+					assets.map((row) => row.value.last_claim),
+					["2022-01-01T01:00:00", "2022-01-01T01:00:00", "2022-01-01T00:00:00"]
+				);
+				assert.deepEqual(getLogs("logclaim"), [
+					{
+						user: "alice",
+						asset_ids: ["1099511627776", "1099511627777"],
+						claimed: "2.00000000 WAX",
+						hourly_rate: "3.00000000 WAX",
+						total_power: "300000000",
+					},
+				]);
+
+				// resume from the next asset
+				await ezstakeContract.actions.claimall(["alice", "1099511627778", 2]).send("alice@active");
+
+				assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					assets.map((row) => row.value.last_claim),
+					["2022-01-01T01:00:00", "2022-01-01T01:00:00", "2022-01-01T01:00:00"]
+				);
+				assert.deepEqual(getLogs("logclaim"), [
+					{ user: "alice", asset_ids: ["1099511627778"], claimed: "1.00000000 WAX", hourly_rate: "3.00000000 WAX", total_power: "300000000" },
+				]);
+			});
+
+			it("skip assets in cooldown", () => {
+				return assert.isRejected(ezstakeContract.actions.claimall(["alice", 0, 10]).send("alice@active"), "nothing to claim");
+			});
+		});
+	});
+
+	describe("rate changes", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// stake some assets for alice
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+
+			// triple the rate after an hour
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "3.00000000 WAX" }]]).send();
+		});
+
+		describe("table storage", () => {
+			it("apply each rate to its own period", async () => {
+				blockchain.setTime(TimePointSec.fromString("2022-01-01T02:00:00"));
+
+				await ezstakeContract.actions.claim(["alice", ["1099511627776"]]).send("alice@active");
+
+				const [balance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+
+				assert.deepEqual(balance.value, { balance: "4.00000000 WAX" });
+			});
+
+			it("append the rate history", () => {
+				const epochs = getTableRows<any[]>(
+					blockchain,
+					ezstakeContract.name.toString(),
+					"epochs",
+					Name.from(UInt64.from(1)).toString()
+				);
+
+				assert.deepEqual(
+					epochs.map((row) => row.value),
+					[
+						{ start: "1970-01-01T00:00:00", hourly_rate: "1.00000000 WAX", integral: "0" },
+						{ start: "2022-01-01T01:00:00", hourly_rate: "3.00000000 WAX", integral: "164099880000000000" },
+					]
+				);
+			});
+		});
+	});
+
+	describe("pool mode", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+			await ezstakeContract.actions.setmode([2]).send();
+			await ezstakeContract.actions.setemission(["100.00000000 WAX"]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice & bob
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake 1 asset for alice & 3 for bob
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+			await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780", "1099511627781", "1099511627782"], "stake"]).send("bob@active");
+		});
+
+		describe("table storage", () => {
+			it("share the emission by power", async () => {
+				blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+				await ezstakeContract.actions.claim(["alice", []]).send("alice@active");
+				await ezstakeContract.actions.claim(["bob", []]).send("bob@active");
+
+				const [aliceBalance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+				const [bobBalance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "bob");
+
+				assert.deepEqual(aliceBalance.value, { balance: "25.00000000 WAX" });
+				assert.deepEqual(bobBalance.value, { balance: "75.00000000 WAX" });
+			});
+
+			it("track the total power", () => {
+				const [pool] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "pool", ezstakeContract.name.toString());
+
+				assert.deepEqual(pool.value, {
+					acc_reward_per_power: "25000000000000",
+					total_power: "400000000",
+					last_update: "2022-01-01T01:00:00",
+				});
+			});
+		});
+	});
+
+	describe("mode switches", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+			await ezstakeContract.actions.setmode([1]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// register alice in accrual mode, then stake in per-asset mode
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.setmode([0]).send();
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+
+			// claim per asset, then switch back to accrual
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T10:00:00"));
+
+			await ezstakeContract.actions.claim(["alice", ["1099511627776"]]).send("alice@active");
+			await ezstakeContract.actions.setmode([1]).send();
+		});
+
+		describe("table storage", () => {
+			it("ignore the checkpoint of an earlier mode", async () => {
+				blockchain.setTime(TimePointSec.fromString("2022-01-01T11:00:00"));
+
+				await ezstakeContract.actions.claim(["alice", []]).send("alice@active");
+
+				const [balance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+
+				assert.deepEqual(balance.value, { balance: "11.00000000 WAX" });
+			});
+		});
+	});
+
+	describe("removed templates", () => {
+		async function stakeAndRemove(mode: number) {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			if (mode > 0) {
+				await ezstakeContract.actions.setmode([mode]).send();
+			}
+
+			if (mode == 2) {
+				await ezstakeContract.actions.setemission(["100.00000000 WAX"]).send();
+			}
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// stake an asset for alice
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+
+			// claim after an hour, then remove the template and re-rate its stakers
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+			await ezstakeContract.actions.claim(["alice", mode == 0 ? ["1099511627776"] : []]).send("alice@active");
+			await ezstakeContract.actions.rmtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+			await ezstakeContract.actions.rerate([1, "", 100]).send();
+
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T11:00:00"));
+		}
+
+		describe("per-asset mode", () => {
+			before(() => stakeAndRemove(0));
+
+			it("disallow claiming the removed template", () => {
+				return assert.isRejected(ezstakeContract.actions.claim(["alice", ["1099511627776"]]).send("alice@active"), "asset (1099511627776) is not stakeable");
+			});
+		});
+
+		describe("accrual mode", () => {
+			before(() => stakeAndRemove(1));
+
+			it("stop the rewards of the removed template", () => {
+				return assert.isRejected(ezstakeContract.actions.claim(["alice", []]).send("alice@active"), "nothing to claim");
+			});
+
+			describe("table storage", () => {
+				it("move the user to a zero rate", () => {
+					const [balance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+					const [user] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+
+					assert.deepEqual(balance.value, { balance: "1.00000000 WAX" });
+					assert.equal(user.value.hourly_rate, "0.00000000 WAX");
+				});
+			});
+		});
+
+		describe("pool mode", () => {
+			before(() => stakeAndRemove(2));
+
+			it("stop the rewards of the removed template", () => {
+				return assert.isRejected(ezstakeContract.actions.claim(["alice", []]).send("alice@active"), "nothing to claim");
+			});
+
+			describe("table storage", () => {
+				it("take the power out of the pool", () => {
+					const [balance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+					const [pool] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "pool", ezstakeContract.name.toString());
+
+					assert.deepEqual(balance.value, { balance: "100.00000000 WAX" });
+					assert.equal(pool.value.total_power, "0");
+				});
+			});
+		});
+	});
 });
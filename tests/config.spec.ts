@@ -164,4 +164,88 @@ describe("config", () => {
 			});
 		});
 	});
+
+	describe("set mode", () => {
+		before(() => {
+			blockchain.resetTables();
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.setmode([1]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow invalid modes", () => {
+			return assert.isRejected(ezstakeContract.actions.setmode([99]).send(), "invalid reward mode");
+		});
+
+		it("set the mode", () => {
+			return assert.isFulfilled(ezstakeContract.actions.setmode([1]).send());
+		});
+
+		it("disallow the same mode", () => {
+			return assert.isRejected(ezstakeContract.actions.setmode([1]).send(), "reward mode is already set");
+		});
+
+		describe("table storage", () => {
+			before(() => {
+				blockchain.resetTables();
+			});
+
+			it("update row", async () => {
+				await ezstakeContract.actions.setmode([1]).send();
+
+				const [row] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "config", ezstakeContract.name.toString());
+
+				return assert.deepEqual(row, {
+					primaryKey: nameToBigInt("config"),
+					payer: ezstakeContract.name.toString(),
+					value: {
+						...DEFAULT_CONFIG_ROW,
+						reward_mode: 1,
+						storage_mode: 0,
+						hourly_emission: "0.00000000 WAX",
+						min_payout: "0.00000000 WAX",
+						ram_mode: 0,
+						mode_switches: 1,
+					},
+				});
+			});
+		});
+	});
+
+	describe("set emission", () => {
+		before(() => {
+			blockchain.resetTables();
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.setemission(["100.00000000 WAX"]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow negative emission", () => {
+			return assert.isRejected(ezstakeContract.actions.setemission(["-1.00000000 WAX"]).send(), "hourly_emission must not be negative");
+		});
+
+		it("disallow wrong token", () => {
+			return assert.isRejected(ezstakeContract.actions.setemission(["1.0000 BTC"]).send(), "symbol mismatch");
+		});
+
+		describe("table storage", () => {
+			before(() => {
+				blockchain.resetTables();
+			});
+
+			it("update row", async () => {
+				await ezstakeContract.actions.setemission(["100.00000000 WAX"]).send();
+
+				const [row] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "config", ezstakeContract.name.toString());
+
+				return assert.deepEqual(row, {
+					primaryKey: nameToBigInt("config"),
+					payer: ezstakeContract.name.toString(),
+					value: { ...DEFAULT_CONFIG_ROW, reward_mode: 0, storage_mode: 0, hourly_emission: "100.00000000 WAX" },
+				});
+			});
+		});
+	});
 });
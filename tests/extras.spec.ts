@@ -0,0 +1,227 @@
+import { Asset, Name, TimePointSec, UInt64 } from "@greymass/eosio";
+import { Blockchain, mintTokens, nameToBigInt, symbolCodeToBigInt } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const eosioTokenContract = blockchain.createContract("eosio.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+const testTokenContract = blockchain.createContract("test.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	return blockchain.getStorage()[code][table][scope];
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("extras", () => {
+	describe("extra reward tokens", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+			await mintTokens(testTokenContract, "BTC", 4, 21e6, 100, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(
+				ezstakeContract.actions.setextras([1, [{ quantity: "0.5000 BTC", contract: "test.token" }]]).send("alice@active"),
+				"this action is admin only"
+			);
+		});
+
+		it("disallow the reward token", () => {
+			return assert.isRejected(
+				ezstakeContract.actions.setextras([1, [{ quantity: "1.00000000 WAX", contract: "eosio.token" }]]).send(),
+				"the reward token can't be an extra token"
+			);
+		});
+
+		it("disallow duplicated tokens", () => {
+			return assert.isRejected(
+				ezstakeContract.actions
+					.setextras([
+						1,
+						[
+							{ quantity: "0.5000 BTC", contract: "test.token" },
+							{ quantity: "0.1000 BTC", contract: "test.token" },
+						],
+					])
+					.send(),
+				"extra token listed more than once"
+			);
+		});
+
+		it("claim every token", async () => {
+			await ezstakeContract.actions.setextras([1, [{ quantity: "0.5000 BTC", contract: "test.token" }]]).send();
+
+			// stake 2 assets for alice
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+			return assert.isFulfilled(ezstakeContract.actions.claim(["alice", ["1099511627776", "1099511627777"]]).send("alice@active"));
+		});
+
+		describe("table storage", () => {
+			it("pay each token", () => {
+				const [waxBalance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+				const [btcBalance] = getTableRows<any[]>(blockchain, testTokenContract.name.toString(), "accounts", "alice");
+
+				assert.deepEqual(waxBalance.value, { balance: "2.00000000 WAX" });
+				assert.deepEqual(btcBalance.value, { balance: "1.0000 BTC" });
+			});
+
+			it("keep the extra rates of the user", () => {
+				const [reward] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "rewards", ezstakeContract.name.toString());
+
+				assert.deepEqual(reward.value, {
+					user: "alice",
+					hourly_rates: [{ quantity: "1.0000 BTC", contract: "test.token" }],
+					accrued: [],
+					last_update: "2022-01-01T01:00:00",
+					last_claim: "2022-01-01T01:00:00",
+				});
+			});
+		});
+	});
+
+	describe("legacy assets", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+			await mintTokens(testTokenContract, "BTC", 4, 21e6, 100, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+			await ezstakeContract.actions.setextras([1, [{ quantity: "0.5000 BTC", contract: "test.token" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake 2 assets for alice
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+
+			// only count one of them and its extra rate, like an asset staked before the counts were kept
+			ezstakeContract.tables.counts([nameToBigInt(ezstakeContract.name)]).set(0n, ezstakeContract.name, {
+				id: "0",
+				user: "alice",
+				template_id: 1,
+				count: "1",
+				hourly_rate: "1.00000000 WAX",
+				extra_rates: [{ quantity: "0.5000 BTC", contract: "test.token" }],
+			});
+			ezstakeContract.tables.rewards([nameToBigInt(ezstakeContract.name)]).set(nameToBigInt("alice"), ezstakeContract.name, {
+				user: "alice",
+				hourly_rates: [{ quantity: "0.5000 BTC", contract: "test.token" }],
+				accrued: [],
+				last_update: "2022-01-01T00:00:00",
+				last_claim: "1970-01-01T00:00:00",
+			});
+
+			// after the unstaking period
+			blockchain.setTime(TimePointSec.fromString("2022-01-04T00:00:00"));
+		});
+
+		it("unstake the uncounted assets", () => {
+			return assert.isFulfilled(ezstakeContract.actions.unstake(["alice", ["1099511627776", "1099511627777"]]).send("alice@active"));
+		});
+
+		describe("table storage", () => {
+			it("only take out the counted extra rates", () => {
+				const [reward] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "rewards", ezstakeContract.name.toString());
+
+				assert.deepEqual(reward.value, {
+					user: "alice",
+					hourly_rates: [],
+					accrued: [{ quantity: "36.0000 BTC", contract: "test.token" }],
+					last_update: "2022-01-04T00:00:00",
+					last_claim: "1970-01-01T00:00:00",
+				});
+			});
+		});
+	});
+});
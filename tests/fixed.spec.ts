@@ -0,0 +1,143 @@
+import { Asset, TimePointSec } from "@greymass/eosio";
+import { Blockchain, mintTokens, symbolCodeToBigInt } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice] = blockchain.createAccounts("dummycol", "alice");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake-fixed", true);
+const eosioTokenContract = blockchain.createContract("eosio.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+}
+
+// built with -DFIXED_CONFIG and the WAX token and periods baked in (npm run build:dev:fixed)
+describe("fixed config", () => {
+	before(async () => {
+		blockchain.resetTables();
+
+		// create dummy collection
+		await createDummyCollection();
+
+		//  mint test tokens
+		await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+	});
+
+	it("leave out the config actions", () => {
+		assert.isUndefined((ezstakeContract.actions as any).setconfig);
+		assert.isUndefined((ezstakeContract.actions as any).settoken);
+	});
+
+	it("run without a config row", async () => {
+		await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+		await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+		const config = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "config", ezstakeContract.name.toString());
+
+		assert.deepEqual(config, []);
+	});
+
+	it("check the baked-in token symbol", () => {
+		return assert.isRejected(
+			ezstakeContract.actions.addtemplates([[{ template_id: 2, collection: "dummycol", hourly_rate: "1.0000 EOS" }]]).send(),
+			"symbol mismatch"
+		);
+	});
+
+	it("use the baked-in claim period", async () => {
+		blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+		await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+
+		blockchain.setTime(TimePointSec.fromString("2022-01-01T00:05:00"));
+
+		return assert.isRejected(
+			ezstakeContract.actions.claim(["alice", ["1099511627776"]]).send("alice@active"),
+			"asset (1099511627776) is still in cooldown"
+		);
+	});
+
+	it("pay the baked-in token", async () => {
+		blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+		await ezstakeContract.actions.claim(["alice", ["1099511627776"]]).send("alice@active");
+
+		const [balance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+
+		assert.deepEqual(balance, {
+			primaryKey: symbolCodeToBigInt(Asset.SymbolCode.from("WAX")),
+			payer: ezstakeContract.name.toString(),
+			value: { balance: "1.00000000 WAX" },
+		});
+	});
+
+	it("use the baked-in unstake period", async () => {
+		blockchain.setTime(TimePointSec.fromString("2022-01-02T01:00:00"));
+
+		await assert.isRejected(
+			ezstakeContract.actions.unstake(["alice", ["1099511627776"]]).send("alice@active"),
+			"asset (1099511627776) cannot be unstaked yet"
+		);
+
+		blockchain.setTime(TimePointSec.fromString("2022-01-04T01:00:00"));
+
+		await assert.isFulfilled(ezstakeContract.actions.unstake(["alice", ["1099511627776"]]).send("alice@active"));
+	});
+});
@@ -0,0 +1,134 @@
+import { TimePointSec } from "@greymass/eosio";
+import { Blockchain } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob] = blockchain.createAccounts("dummycol", "alice", "bob");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("getters", () => {
+	before(async () => {
+		blockchain.resetTables();
+
+		// to initiate the config table
+		await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+		// create dummy collection
+		await createDummyCollection();
+
+		// set staking templates
+		await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+		// register alice
+		await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+		// set blockchain time
+		blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+		// stake some assets for alice
+		await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777", "1099511627778"], "stake"]).send("alice@active");
+
+		blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+	});
+
+	describe("get pending", () => {
+		it("require a positive limit", () => {
+			return assert.isRejected(ezstakeContract.actions.getpending(["alice", 0, 0]).send(), "limit must be positive");
+		});
+
+		it("require a registered user", () => {
+			return assert.isRejected(ezstakeContract.actions.getpending(["bob", 0, 10]).send(), "user bob is not registered");
+		});
+
+		it("read without authorization", () => {
+			return assert.isFulfilled(ezstakeContract.actions.getpending(["alice", "1099511627777", 1]).send("bob@active"));
+		});
+
+		describe("table storage", () => {
+			it("leave the assets untouched", () => {
+				const assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					assets.map((row) => row.value.last_claim),
+					["2022-01-01T00:00:00", "2022-01-01T00:00:00", "2022-01-01T00:00:00"]
+				);
+			});
+		});
+	});
+
+	describe("get stake", () => {
+		it("require a positive limit", () => {
+			return assert.isRejected(ezstakeContract.actions.getstake(["alice", 0, 0]).send(), "limit must be positive");
+		});
+
+		it("read without authorization", () => {
+			return assert.isFulfilled(ezstakeContract.actions.getstake(["alice", 0, 2]).send("bob@active"));
+		});
+	});
+});
@@ -0,0 +1,175 @@
+import { TimePointSec } from "@greymass/eosio";
+import { Blockchain, mintTokens } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake-leaderboard", true);
+const eosioTokenContract = blockchain.createContract("eosio.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to clark
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "clark", [], [], []]).send("dummycol@active");
+	}
+}
+
+function getLeaders() {
+	const leaders = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "leaders", ezstakeContract.name.toString());
+	const [stats] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "stats", ezstakeContract.name.toString());
+
+	return { leaders: leaders.map((row) => row.value), count: stats.value.leaders };
+}
+
+// built with -DLEADERBOARD_SIZE=2 (npm run build:dev:leaderboard)
+describe("leaderboard", () => {
+	before(async () => {
+		blockchain.resetTables();
+
+		// to initiate the config table
+		await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+		// create dummy collection
+		await createDummyCollection();
+
+		//  mint test tokens
+		await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+		// set staking templates
+		await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+		// register alice, bob & clark
+		await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+		await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+		await ezstakeContract.actions.regnewuser(["clark"]).send("clark@active");
+
+		// set blockchain time
+		blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+		// stake some assets for alice & bob
+		await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+		await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780", "1099511627781"], "stake"]).send("bob@active");
+	});
+
+	it("fill the leaderboard", () => {
+		assert.deepEqual(getLeaders(), {
+			leaders: [
+				{ user: "alice", hourly_rate: "100000000" },
+				{ user: "bob", hourly_rate: "200000000" },
+			],
+			count: 2,
+		});
+	});
+
+	it("evict the lowest leader", async () => {
+		await atomicassetsContract.actions.transfer(["clark", "ezstake", ["1099511627784", "1099511627785", "1099511627786"], "stake"]).send("clark@active");
+
+		assert.deepEqual(getLeaders(), {
+			leaders: [
+				{ user: "bob", hourly_rate: "200000000" },
+				{ user: "clark", hourly_rate: "300000000" },
+			],
+			count: 2,
+		});
+	});
+
+	it("drop a leader falling below the others", async () => {
+		// after the unstaking period
+		blockchain.setTime(TimePointSec.fromString("2022-01-04T00:00:00"));
+
+		await ezstakeContract.actions.unstake(["bob", ["1099511627780"]]).send("bob@active");
+
+		assert.deepEqual(getLeaders(), {
+			leaders: [{ user: "clark", hourly_rate: "300000000" }],
+			count: 1,
+		});
+	});
+
+	it("promote a user to the free spot", async () => {
+		await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627777"], "stake"]).send("alice@active");
+
+		assert.deepEqual(getLeaders(), {
+			leaders: [
+				{ user: "alice", hourly_rate: "200000000" },
+				{ user: "clark", hourly_rate: "300000000" },
+			],
+			count: 2,
+		});
+	});
+
+	it("remove a user that unstakes everything", async () => {
+		// after the unstaking period
+		blockchain.setTime(TimePointSec.fromString("2022-01-07T00:00:00"));
+
+		await ezstakeContract.actions.unstake(["clark", ["1099511627784", "1099511627785", "1099511627786"]]).send("clark@active");
+
+		assert.deepEqual(getLeaders(), {
+			leaders: [{ user: "alice", hourly_rate: "200000000" }],
+			count: 1,
+		});
+	});
+});
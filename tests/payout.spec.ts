@@ -0,0 +1,236 @@
+import { Asset, Name, TimePointSec, UInt64 } from "@greymass/eosio";
+import { Blockchain, mintTokens, nameToBigInt, symbolCodeToBigInt } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const eosioTokenContract = blockchain.createContract("eosio.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	return blockchain.getStorage()[code][table][scope];
+}
+
+// the payloads of the log actions sent by the last transaction
+function getLogs(action: string) {
+	return blockchain.actionTraces
+		.filter((trace) => trace.contract.toString() === "ezstake" && trace.action.toString() === action)
+		.map((trace) => JSON.parse(JSON.stringify(trace.decodedData)));
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("payout", () => {
+	describe("auto-payout crank", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+			await ezstakeContract.actions.setmode([1]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice & bob
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake 1 asset for alice and 2 for bob
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+			await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780", "1099511627781"], "stake"]).send("bob@active");
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.setpayout(["1.00000000 WAX"]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow while disabled", () => {
+			return assert.isRejected(ezstakeContract.actions.crank([10]).send("clark@active"), "auto-payout is disabled");
+		});
+
+		it("pay out the users above the threshold", async () => {
+			await ezstakeContract.actions.setpayout(["1.50000000 WAX"]).send();
+
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+			return assert.isFulfilled(ezstakeContract.actions.crank([10]).send("clark@active"));
+		});
+
+		it("log the payout", () => {
+			assert.deepEqual(getLogs("logclaim"), [
+				{ user: "bob", asset_ids: [], claimed: "2.00000000 WAX", hourly_rate: "2.00000000 WAX", total_power: "300000000" },
+			]);
+		});
+
+		describe("table storage", () => {
+			it("pay bob only", () => {
+				const aliceBalance = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+				const [bobBalance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "bob");
+
+				assert.isUndefined(aliceBalance);
+				assert.deepEqual(bobBalance.value, { balance: "2.00000000 WAX" });
+			});
+
+			it("count the payout as claimed", () => {
+				const [stats] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "stats", ezstakeContract.name.toString());
+
+				assert.equal(stats.value.total_claimed, "200000000");
+			});
+		});
+	});
+
+	describe("log each payout", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+			await ezstakeContract.actions.setmode([1]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice & bob
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake 1 asset for alice and 2 for bob
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+			await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780", "1099511627781"], "stake"]).send("bob@active");
+			await ezstakeContract.actions.setpayout(["0.50000000 WAX"]).send();
+
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+			await ezstakeContract.actions.crank([10]).send("clark@active");
+		});
+
+		it("send a log per paid user", () => {
+			assert.deepEqual(getLogs("logclaim"), [
+				{ user: "alice", asset_ids: [], claimed: "1.00000000 WAX", hourly_rate: "1.00000000 WAX", total_power: "300000000" },
+				{ user: "bob", asset_ids: [], claimed: "2.00000000 WAX", hourly_rate: "2.00000000 WAX", total_power: "300000000" },
+			]);
+		});
+	});
+
+	describe("users staking since the per-asset mode", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice & bob
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake 1 asset for alice and 2 for bob, then switch to the accrual mode
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+			await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780", "1099511627781"], "stake"]).send("bob@active");
+			await ezstakeContract.actions.setmode([1]).send();
+			await ezstakeContract.actions.setpayout(["0.50000000 WAX"]).send();
+
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+			// only bob gets a checkpoint
+			await ezstakeContract.actions.recount(["bob"]).send();
+			await ezstakeContract.actions.crank([10]).send("clark@active");
+		});
+
+		describe("table storage", () => {
+			it("pay the users with a checkpoint only", () => {
+				const aliceBalance = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "alice");
+				const [bobBalance] = getTableRows<any[]>(blockchain, eosioTokenContract.name.toString(), "accounts", "bob");
+
+				assert.isUndefined(aliceBalance);
+				assert.deepEqual(bobBalance.value, { balance: "2.00000000 WAX" });
+			});
+		});
+	});
+});
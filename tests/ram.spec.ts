@@ -0,0 +1,140 @@
+import { Asset, Name, TimePointSec, UInt64 } from "@greymass/eosio";
+import { Blockchain, mintTokens, nameToBigInt, symbolCodeToBigInt } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const eosioTokenContract = blockchain.createContract("eosio.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	return blockchain.getStorage()[code][table][scope];
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("ram", () => {
+	describe("user RAM mode", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			//  mint test tokens
+			await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.setrammode([1]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow deposits in the contract RAM mode", () => {
+			return assert.isRejected(ezstakeContract.actions.depositram(["alice", 1000]).send("alice@active"), "RAM deposits are disabled");
+		});
+
+		it("switch to the user RAM mode", () => {
+			return assert.isFulfilled(ezstakeContract.actions.setrammode([1]).send());
+		});
+
+		it("disallow staking without a deposit", () => {
+			return assert.isRejected(
+				atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active"),
+				"user alice has not deposited enough RAM, 404 bytes required"
+			);
+		});
+
+		it("stake out of the deposit", async () => {
+			await ezstakeContract.actions.depositram(["alice", 1000]).send("alice@active");
+
+			return assert.isFulfilled(atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active"));
+		});
+
+		it("disallow withdrawing more than the deposit", () => {
+			return assert.isRejected(ezstakeContract.actions.withdrawram(["alice", 193]).send("alice@active"), "user alice has not deposited 193 bytes");
+		});
+
+		describe("table storage", () => {
+			it("bill the assets rows to alice", () => {
+				const assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					assets.map((row) => row.payer),
+					["alice", "alice"]
+				);
+			});
+
+			it("take the rows' RAM out of the deposit", () => {
+				const [deposit] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "ramdeposits", ezstakeContract.name.toString());
+
+				assert.equal(deposit.value.user, "alice");
+				assert.lengthOf(deposit.value.reserved, 192);
+			});
+		});
+	});
+});
@@ -0,0 +1,212 @@
+import { TimePointSec } from "@greymass/eosio";
+import { Blockchain } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("rerate", () => {
+	describe("re-rate users", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice & bob
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake some assets for alice & bob
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+			await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780"], "stake"]).send("bob@active");
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.rerate([1, "", 100]).send("alice@active"), "this action is admin only");
+		});
+
+		it("require a pending rate change", () => {
+			return assert.isRejected(ezstakeContract.actions.rerate([1, "", 100]).send(), "template (1) is not pending a re-rate");
+		});
+
+		it("queue the rate change", async () => {
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "2.00000000 WAX" }]]).send();
+
+			const rerates = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "rerates", ezstakeContract.name.toString());
+
+			assert.deepEqual(
+				rerates.map((row) => row.value),
+				[{ template_id: 1 }]
+			);
+		});
+
+		it("disallow a second change while re-rating", () => {
+			return assert.isRejected(
+				ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "3.00000000 WAX" }]]).send(),
+				"template (1) is still being re-rated"
+			);
+		});
+
+		it("re-rate in batches", async () => {
+			await ezstakeContract.actions.rerate([1, "", 1]).send();
+			await ezstakeContract.actions.rerate([1, "bob", 1]).send();
+
+			const rerates = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "rerates", ezstakeContract.name.toString());
+
+			assert.deepEqual(rerates, []);
+		});
+
+		it("unstake at the new rate", () => {
+			blockchain.addTime(TimePointSec.fromInteger(259200));
+
+			return assert.isFulfilled(ezstakeContract.actions.unstake(["alice", ["1099511627776"]]).send("alice@active"));
+		});
+
+		describe("table storage", () => {
+			it("move the users to the new rate", () => {
+				const users = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					users.map((row) => row.value),
+					[
+						{ user: "alice", hourly_rate: "2.00000000 WAX" },
+						{ user: "bob", hourly_rate: "2.00000000 WAX" },
+					]
+				);
+			});
+
+			it("keep the per-template counts", () => {
+				const counts = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "counts", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					counts.map((row) => row.value),
+					[
+						{ id: "0", user: "alice", template_id: 1, count: "1", hourly_rate: "2.00000000 WAX" },
+						{ id: "1", user: "bob", template_id: 1, count: "1", hourly_rate: "2.00000000 WAX" },
+					]
+				);
+			});
+		});
+	});
+
+	describe("recount user", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// stake some assets for alice
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.recount(["alice"]).send("alice@active"), "this action is admin only");
+		});
+
+		it("require a registered user", () => {
+			return assert.isRejected(ezstakeContract.actions.recount(["bob"]).send(), "user bob is not registered");
+		});
+
+		it("recount the user", () => {
+			return assert.isFulfilled(ezstakeContract.actions.recount(["alice"]).send());
+		});
+
+		describe("table storage", () => {
+			it("rebuild the counts", () => {
+				const counts = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "counts", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					counts.map((row) => row.value),
+					[{ id: "0", user: "alice", template_id: 1, count: "2", hourly_rate: "1.00000000 WAX" }]
+				);
+			});
+		});
+	});
+});
@@ -18,6 +18,13 @@ function getTableRows<T>(blockchain: Blockchain, code: string, table: string, sc
 	return scopeStorage;
 }
 
+// the payloads of the log actions sent by the last transaction
+function getLogs(action: string) {
+	return blockchain.actionTraces
+		.filter((trace) => trace.contract.toString() === "ezstake" && trace.action.toString() === action)
+		.map((trace) => JSON.parse(JSON.stringify(trace.decodedData)));
+}
+
 async function createDummyCollection() {
 	await atomicassetsContract.actions.init().send();
 	await atomicassetsContract.actions
@@ -104,9 +111,23 @@ describe("reset", () => {
 		});
 
 		it("reset the user", async () => {
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
 			return assert.isFulfilled(ezstakeContract.actions.resetuser(["alice"]).send());
 		});
 
+		it("log the forfeited rewards", () => {
+			assert.deepEqual(getLogs("logreset"), [
+				{
+					user: "alice",
+					asset_ids: ["1099511627776", "1099511627777"],
+					forfeited: "2.00000000 WAX",
+					hourly_rate: "0.00000000 WAX",
+					total_power: "100000000",
+				},
+			]);
+		});
+
 		describe("table storage", () => {
 			before(async () => {
 				blockchain.resetTables();
@@ -155,11 +176,178 @@ describe("reset", () => {
 					{
 						primaryKey: 1099511627780n,
 						payer: ezstakeContract.name.toString(),
-						value: { asset_id: "1099511627780", owner: "bob", last_claim: "2022-01-01T00:00:00" },
-						secondaryIndexes: [{ type: "idxu64", value: nameToBigInt("bob") }],
+						value: {
+							asset_id: "1099511627780",
+							owner: "bob",
+							last_claim: "2022-01-01T00:00:00",
+							template_id: 1,
+							collection: "dummycol",
+						},
+						secondaryIndexes: [
+							{ type: "idxu64", value: nameToBigInt("bob") },
+							{ type: "idx128", value: (nameToBigInt("bob") << 64n) | 1099511627780n },
+						],
+					},
+				]);
+			});
+		});
+	});
+
+	describe("reset user in batches", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice & bob
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake some assets for alice
+			await atomicassetsContract.actions
+				.transfer(["alice", "ezstake", ["1099511627776", "1099511627777", "1099511627778"], "stake"])
+				.send("alice@active");
+			// stake some assets for bob
+			await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780"], "stake"]).send("bob@active");
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.resetbatch(["alice", 2]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow zero max_rows", () => {
+			return assert.isRejected(ezstakeContract.actions.resetbatch(["alice", 0]).send(), "max_rows must be positive");
+		});
+
+		describe("table storage", () => {
+			it("keep progress between batches", async () => {
+				await ezstakeContract.actions.resetbatch(["alice", 2]).send();
+
+				const players = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+				const assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+				const resets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "resets", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					players.map((row) => row.value),
+					[
+						{ user: "alice", hourly_rate: "0.00000000 WAX" },
+						{ user: "bob", hourly_rate: "1.00000000 WAX" },
+					]
+				);
+				assert.deepEqual(
+					assets.map((row) => row.value.asset_id),
+					["1099511627778", "1099511627780"]
+				);
+				assert.deepEqual(getLogs("logreset"), [
+					{
+						user: "alice",
+						asset_ids: ["1099511627776", "1099511627777"],
+						forfeited: "0.00000000 WAX",
+						hourly_rate: "0.00000000 WAX",
+						total_power: "100000000",
+					},
+				]);
+				assert.deepEqual(resets, [
+					{
+						primaryKey: nameToBigInt("alice"),
+						payer: ezstakeContract.name.toString(),
+						value: { user: "alice", processed: 2, started: "2022-01-01T00:00:00", is_per_asset: true },
 					},
 				]);
 			});
+
+			it("disallow the user's actions between batches", async () => {
+				await assert.isRejected(
+					atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627779"], "stake"]).send("alice@active"),
+					"user alice is being reset"
+				);
+				await assert.isRejected(ezstakeContract.actions.claim(["alice", ["1099511627778"]]).send("alice@active"), "user alice is being reset");
+				await assert.isRejected(ezstakeContract.actions.unstake(["alice", ["1099511627778"]]).send("alice@active"), "user alice is being reset");
+			});
+
+			it("remove the user after the last batch", async () => {
+				await ezstakeContract.actions.resetbatch(["alice", 2]).send();
+
+				const players = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+				const assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+				const resets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "resets", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					players.map((row) => row.value.user),
+					["bob"]
+				);
+				assert.deepEqual(
+					assets.map((row) => row.value.asset_id),
+					["1099511627780"]
+				);
+				assert.deepEqual(resets, []);
+				assert.deepEqual(getLogs("logreset"), [
+					{ user: "alice", asset_ids: ["1099511627778"], forfeited: "0.00000000 WAX", hourly_rate: "0.00000000 WAX", total_power: "100000000" },
+				]);
+			});
+		});
+	});
+
+	describe("reset a per-asset user in batches after the switch to accrual", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake some assets for alice, then switch to the accrual mode
+			await atomicassetsContract.actions
+				.transfer(["alice", "ezstake", ["1099511627776", "1099511627777", "1099511627778"], "stake"])
+				.send("alice@active");
+			await ezstakeContract.actions.setmode([1]).send();
+		});
+
+		describe("table storage", () => {
+			it("count the forfeited rewards per asset", async () => {
+				blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+				await ezstakeContract.actions.resetbatch(["alice", 1]).send();
+
+				const [user] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+				const resets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "resets", ezstakeContract.name.toString());
+
+				// the user gets a checkpoint, the assets left are counted by the next batches
+				assert.deepEqual(user.value, {
+					user: "alice",
+					hourly_rate: "0.00000000 WAX",
+					accrued: "0.00000000 WAX",
+					last_update: "2022-01-01T01:00:00",
+					last_claim: "1970-01-01T00:00:00",
+					reward_debt: "0",
+					mode_switch: 1,
+				});
+				assert.deepEqual(
+					resets.map((row) => row.value),
+					[{ user: "alice", processed: 1, started: "2022-01-01T01:00:00", is_per_asset: true }]
+				);
+			});
 		});
 	});
 });
@@ -0,0 +1,248 @@
+import { TimePointSec } from "@greymass/eosio";
+import { Blockchain } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob, clark] = blockchain.createAccounts("dummycol", "alice", "bob", "clark");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("rules", () => {
+	describe("rate rules", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+		});
+
+		it("require contract auth", () => {
+			return assert.isRejected(ezstakeContract.actions.setrule(["dummycol", "", "1.00000000 WAX"]).send("alice@active"), "this action is admin only");
+		});
+
+		it("disallow unknown collection/schema", () => {
+			assert.isRejected(ezstakeContract.actions.setrule(["invalidcol", "", "1.00000000 WAX"]).send(), "collection invalidcol not found");
+
+			return assert.isRejected(
+				ezstakeContract.actions.setrule(["dummycol", "invalid", "1.00000000 WAX"]).send(),
+				"schema invalid not found in collection dummycol"
+			);
+		});
+
+		it("zero hourly rate", () => {
+			return assert.isRejected(ezstakeContract.actions.setrule(["dummycol", "", "0.00000000 WAX"]).send(), "hourly_rate must be positive");
+		});
+
+		it("disallow removing a missing rule", () => {
+			return assert.isRejected(ezstakeContract.actions.rmrule(["dummycol", ""]).send(), "no rule for dummycol");
+		});
+
+		it("disallow templates without rule", () => {
+			return assert.isRejected(
+				atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active"),
+				"asset (1099511627776) is not stakeable"
+			);
+		});
+
+		it("stake through the collection rule", async () => {
+			await ezstakeContract.actions.setrule(["dummycol", "", "1.00000000 WAX"]).send();
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+
+			const templates = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "templates", ezstakeContract.name.toString());
+
+			assert.deepEqual(
+				templates.map((row) => row.value),
+				[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX", staked: "2", from_rule: true }]
+			);
+		});
+
+		it("sync to the schema rule", async () => {
+			await ezstakeContract.actions.setrule(["dummycol", "dummyschema", "2.00000000 WAX"]).send();
+			await ezstakeContract.actions.syncrules(["dummycol", 0, 100]).send();
+
+			const templates = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "templates", ezstakeContract.name.toString());
+			const rerates = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "rerates", ezstakeContract.name.toString());
+
+			assert.deepEqual(
+				templates.map((row) => row.value),
+				[{ template_id: 1, collection: "dummycol", hourly_rate: "2.00000000 WAX", staked: "2", from_rule: true }]
+			);
+			assert.deepEqual(
+				rerates.map((row) => row.value),
+				[{ template_id: 1 }]
+			);
+		});
+
+		describe("table storage", () => {
+			it("keep the rules by collection", () => {
+				const rules = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "rules", "dummycol");
+
+				assert.deepEqual(
+					rules.map((row) => row.value),
+					[
+						{ schema: "", hourly_rate: "1.00000000 WAX" },
+						{ schema: "dummyschema", hourly_rate: "2.00000000 WAX" },
+					]
+				);
+			});
+		});
+	});
+
+	describe("rule removal", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+			await ezstakeContract.actions.setmode([1]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// stake through the collection rule
+			await ezstakeContract.actions.setrule(["dummycol", "", "1.00000000 WAX"]).send();
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+		});
+
+		it("remove the template and re-rate its stakers", async () => {
+			await ezstakeContract.actions.rmrule(["dummycol", ""]).send();
+			await ezstakeContract.actions.syncrules(["dummycol", 0, 100]).send();
+
+			return assert.isFulfilled(ezstakeContract.actions.rerate([1, "", 100]).send());
+		});
+
+		describe("table storage", () => {
+			it("move the user to a zero rate", () => {
+				const templates = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "templates", ezstakeContract.name.toString());
+				const [user] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+
+				assert.deepEqual(templates, []);
+				assert.equal(user.value.hourly_rate, "0.00000000 WAX");
+			});
+		});
+	});
+
+	describe("template exclusion", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// register alice
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+
+			// stake through the collection rule
+			await ezstakeContract.actions.setrule(["dummycol", "", "1.00000000 WAX"]).send();
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776"], "stake"]).send("alice@active");
+		});
+
+		it("exclude a removed template from the rules", async () => {
+			await ezstakeContract.actions.rmtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			return assert.isRejected(
+				atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627777"], "stake"]).send("alice@active"),
+				"asset (1099511627777) is not stakeable"
+			);
+		});
+
+		it("keep the exclusions by collection", () => {
+			const exclusions = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "exclusions", "dummycol");
+
+			assert.deepEqual(
+				exclusions.map((row) => row.value),
+				[{ template_id: 1 }]
+			);
+		});
+
+		it("lift the exclusion with a rate of its own", async () => {
+			await ezstakeContract.actions.rerate([1, "", 100]).send();
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "2.00000000 WAX" }]]).send();
+			await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627777"], "stake"]).send("alice@active");
+
+			const exclusions = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "exclusions", "dummycol");
+
+			assert.deepEqual(exclusions, []);
+		});
+	});
+});
@@ -14,6 +14,13 @@ function getTableRows<T>(blockchain: Blockchain, code: string, table: string, sc
 	return blockchain.getStorage()[code][table][scope];
 }
 
+// the payloads of the log actions sent by the last transaction
+function getLogs(action: string) {
+	return blockchain.actionTraces
+		.filter((trace) => trace.contract.toString() === "ezstake" && trace.action.toString() === action)
+		.map((trace) => JSON.parse(JSON.stringify(trace.decodedData)));
+}
+
 async function createDummyCollection() {
 	await atomicassetsContract.actions.init().send();
 	await atomicassetsContract.actions
@@ -120,6 +127,18 @@ describe("stake", () => {
 			);
 		});
 
+		it("log the stake", () => {
+			assert.deepEqual(getLogs("logstake"), [
+				{
+					user: "alice",
+					asset_ids: ["1099511627779"],
+					added_rate: "1.00000000 WAX",
+					hourly_rate: "1.00000000 WAX",
+					total_power: "100000000",
+				},
+			]);
+		});
+
 		it("disallow unstakeable templates", () => {
 			return assert.isRejected(
 				atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627800"], "stake"]).send("alice@active"),
@@ -171,8 +190,17 @@ describe("stake", () => {
 					{
 						primaryKey: 1099511627779n,
 						payer: ezstakeContract.name.toString(),
-						value: { asset_id: "1099511627779", owner: "alice", last_claim: "2022-01-01T00:00:00" },
-						secondaryIndexes: [{ type: "idxu64", value: nameToBigInt("alice") }],
+						value: {
+							asset_id: "1099511627779",
+							owner: "alice",
+							last_claim: "2022-01-01T00:00:00",
+							template_id: 1,
+							collection: "dummycol",
+						},
+						secondaryIndexes: [
+							{ type: "idxu64", value: nameToBigInt("alice") },
+							{ type: "idx128", value: (nameToBigInt("alice") << 64n) | 1099511627779n },
+						],
 					},
 				]);
 			});
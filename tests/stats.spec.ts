@@ -0,0 +1,164 @@
+import { TimePointSec } from "@greymass/eosio";
+import { Blockchain, mintTokens } from "@proton/vert";
+import chai, { assert } from "chai";
+import chaiAsPromised from "chai-as-promised";
+
+chai.use(chaiAsPromised);
+
+const blockchain = new Blockchain();
+const [dummycol, alice, bob] = blockchain.createAccounts("dummycol", "alice", "bob");
+const ezstakeContract = blockchain.createContract("ezstake", "contract/ezstake", true);
+const eosioTokenContract = blockchain.createContract("eosio.token", "node_modules/proton-tsc/external/eosio.token/eosio.token", true);
+const atomicassetsContract = blockchain.createContract("atomicassets", "node_modules/proton-tsc/external/atomicassets/atomicassets", true);
+
+function getTableRows<T>(blockchain: Blockchain, code: string, table: string, scope: string): T {
+	const storage = blockchain.getStorage();
+	const contractStorage = storage[code] || {};
+	const tableStorage = contractStorage[table] || {};
+	const scopeStorage = tableStorage[scope] || [];
+	return scopeStorage;
+}
+
+async function createDummyCollection() {
+	await atomicassetsContract.actions.init().send();
+	await atomicassetsContract.actions
+		.admincoledit([
+			[
+				{ name: "name", type: "string" },
+				{ name: "img", type: "ipfs" },
+				{ name: "description", type: "string" },
+				{ name: "url", type: "string" },
+			],
+		])
+		.send();
+
+	await atomicassetsContract.actions.createcol(["dummycol", "dummycol", true, ["dummycol", "ezstake"], [], 0.01, []]).send("dummycol@active");
+	await atomicassetsContract.actions
+		.createschema([
+			"dummycol",
+			"dummycol",
+			"dummyschema",
+			[
+				{ name: "image", type: "string" },
+				{ name: "name", type: "string" },
+			],
+		])
+		.send("dummycol@active");
+
+	for (let i = 0; i < 5; i++) {
+		await atomicassetsContract.actions
+			.createtempl([
+				"dummycol",
+				"dummycol",
+				"dummyschema",
+				true,
+				true,
+				100000,
+				[
+					{ key: "image", value: ["string", "dummy.png"] },
+					{ key: "name", value: ["string", "Dummy"] },
+				],
+			])
+			.send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to alice
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "alice", [], [], []]).send("dummycol@active");
+	}
+
+	// mint 4 assets from template 1 to bob
+	for (let i = 0; i < 4; i++) {
+		await atomicassetsContract.actions.mintasset(["dummycol", "dummycol", "dummyschema", 1, "bob", [], [], []]).send("dummycol@active");
+	}
+}
+
+describe("stats", () => {
+	before(async () => {
+		blockchain.resetTables();
+
+		// to initiate the config table
+		await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+		// create dummy collection
+		await createDummyCollection();
+
+		//  mint test tokens
+		await mintTokens(eosioTokenContract, "WAX", 8, 3e9, 1e3, [ezstakeContract]);
+
+		// set staking templates
+		await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+		// register alice & bob
+		await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+		await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+		// set blockchain time
+		blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+		// stake some assets for alice & bob
+		await atomicassetsContract.actions.transfer(["alice", "ezstake", ["1099511627776", "1099511627777"], "stake"]).send("alice@active");
+		await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780"], "stake"]).send("bob@active");
+
+		// claim alice's rewards an hour later
+		blockchain.setTime(TimePointSec.fromString("2022-01-01T01:00:00"));
+
+		await ezstakeContract.actions.claim(["alice", ["1099511627776", "1099511627777"]]).send("alice@active");
+	});
+
+	it("read the stats", () => {
+		return assert.isFulfilled(ezstakeContract.actions.getstats([]).send());
+	});
+
+	describe("table storage", () => {
+		it("count the users, assets and claims", () => {
+			const [stats] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "stats", ezstakeContract.name.toString());
+
+			assert.deepEqual(stats.value, {
+				users: "2",
+				staked_assets: "3",
+				total_power: "300000000",
+				total_claimed: "200000000",
+				liability: "360000000000",
+				last_update: "2022-01-01T01:00:00",
+			});
+		});
+
+		it("count the staked assets per template", () => {
+			const [template] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "templates", ezstakeContract.name.toString());
+
+			assert.deepEqual(template.value, { template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX", staked: "3", from_rule: false });
+		});
+
+		it("remove a reset user", async () => {
+			await ezstakeContract.actions.resetuser(["bob"]).send();
+
+			const [stats] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "stats", ezstakeContract.name.toString());
+
+			assert.deepEqual(stats.value, {
+				users: "1",
+				staked_assets: "2",
+				total_power: "200000000",
+				total_claimed: "200000000",
+				liability: "0",
+				last_update: "2022-01-01T01:00:00",
+			});
+		});
+
+		it("count the assets of a re-added template as they are re-rated", async () => {
+			await ezstakeContract.actions.rmtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+			await ezstakeContract.actions.rerate([1, "", 100]).send();
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			const [readded] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "templates", ezstakeContract.name.toString());
+
+			assert.deepEqual(readded.value, { template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX", staked: "0", from_rule: false });
+
+			await ezstakeContract.actions.rerate([1, "", 100]).send();
+
+			const [template] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "templates", ezstakeContract.name.toString());
+
+			assert.deepEqual(template.value, { template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX", staked: "2", from_rule: false });
+		});
+	});
+});
@@ -1,3 +1,4 @@
+import { Name, UInt64 } from "@greymass/eosio";
 import { Blockchain } from "@proton/vert";
 import chai, { assert } from "chai";
 import chaiAsPromised from "chai-as-promised";
@@ -149,15 +150,22 @@ describe("config", () => {
 					{
 						primaryKey: 1n,
 						payer: ezstakeContract.name.toString(),
-						value: { template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" },
+						value: { template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX", staked: "0", from_rule: false },
 					},
 					{
 						primaryKey: 2n,
 						payer: ezstakeContract.name.toString(),
-						value: { template_id: 2, collection: "dummycol", hourly_rate: "2.00000000 WAX" },
+						value: { template_id: 2, collection: "dummycol", hourly_rate: "2.00000000 WAX", staked: "0", from_rule: false },
 					},
 				]);
 			});
+
+			it("keep no rate history for the new templates", () => {
+				// the table is only created by the first rate change
+				const epochs = blockchain.getStorage()[ezstakeContract.name.toString()]["epochs"];
+
+				assert.isEmpty(epochs?.[Name.from(UInt64.from(1)).toString()] ?? []);
+			});
 		});
 	});
 
@@ -215,10 +223,71 @@ describe("config", () => {
 					{
 						primaryKey: 2n,
 						payer: ezstakeContract.name.toString(),
-						value: { template_id: 2, collection: "dummycol", hourly_rate: "2.00000000 WAX" },
+						value: { template_id: 2, collection: "dummycol", hourly_rate: "2.00000000 WAX", staked: "0", from_rule: false },
 					},
 				]);
 			});
 		});
 	});
+
+	describe("import templates", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+		});
+
+		it("require contract auth", () => {
+			assert.isRejected(ezstakeContract.actions.stageimport([[]]).send("alice@active"), "this action is admin only");
+
+			return assert.isRejected(ezstakeContract.actions.commitimport([10]).send("alice@active"), "this action is admin only");
+		});
+
+		it("stage the templates", () => {
+			return assert.isFulfilled(
+				ezstakeContract.actions
+					.stageimport([
+						[
+							{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" },
+							{ template_id: 2, collection: "invalidcol", hourly_rate: "2.00000000 WAX" },
+							{ template_id: 99, collection: "dummycol", hourly_rate: "1.00000000 WAX" },
+						],
+					])
+					.send()
+			);
+		});
+
+		it("commit the templates", () => {
+			return assert.isFulfilled(ezstakeContract.actions.commitimport([10]).send());
+		});
+
+		describe("table storage", () => {
+			it("add the valid templates", () => {
+				const rows = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "templates", ezstakeContract.name.toString());
+
+				assert.deepEqual(
+					rows.map((row) => row.value),
+					[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX", staked: "0", from_rule: false }]
+				);
+			});
+
+			it("keep the invalid templates aside", () => {
+				const staged = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "imports", ezstakeContract.name.toString());
+				const invalid = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "imports", "invalid");
+
+				assert.deepEqual(staged || [], []);
+				assert.deepEqual(
+					invalid.map((row) => row.value),
+					[
+						{ template_id: 2, collection: "invalidcol", hourly_rate: "2.00000000 WAX", error: 12 },
+						{ template_id: 99, collection: "dummycol", hourly_rate: "1.00000000 WAX", error: 12 },
+					]
+				);
+			});
+		});
+	});
 });
@@ -18,6 +18,13 @@ function getTableRows<T>(blockchain: Blockchain, code: string, table: string, sc
 	return scopeStorage;
 }
 
+// the payloads of the log actions sent by the last transaction
+function getLogs(action: string) {
+	return blockchain.actionTraces
+		.filter((trace) => trace.contract.toString() === "ezstake" && trace.action.toString() === action)
+		.map((trace) => JSON.parse(JSON.stringify(trace.decodedData)));
+}
+
 async function createDummyCollection() {
 	await atomicassetsContract.actions.init().send();
 	await atomicassetsContract.actions
@@ -148,6 +155,18 @@ describe("unstake", () => {
 			return assert.isFulfilled(ezstakeContract.actions.unstake(["alice", ["1099511627776"]]).send("alice@active"));
 		});
 
+		it("log the unstake", () => {
+			assert.deepEqual(getLogs("logunstake"), [
+				{
+					user: "alice",
+					asset_ids: ["1099511627776"],
+					removed_rate: "1.00000000 WAX",
+					hourly_rate: "0.00000000 WAX",
+					total_power: "100000000",
+				},
+			]);
+		});
+
 		describe("table storage", () => {
 			before(async () => {
 				blockchain.resetTables();
@@ -198,4 +217,99 @@ describe("unstake", () => {
 			});
 		});
 	});
+
+	describe("unstake all assets", () => {
+		before(async () => {
+			blockchain.resetTables();
+
+			// to initiate the config table
+			await ezstakeContract.actions.setconfig([600, 259200]).send();
+
+			// create dummy collection
+			await createDummyCollection();
+
+			// set staking templates
+			await ezstakeContract.actions.addtemplates([[{ template_id: 1, collection: "dummycol", hourly_rate: "1.00000000 WAX" }]]).send();
+
+			// register alice & bob
+			await ezstakeContract.actions.regnewuser(["alice"]).send("alice@active");
+			await ezstakeContract.actions.regnewuser(["bob"]).send("bob@active");
+
+			// set blockchain time
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:00"));
+
+			// stake some assets for alice
+			await atomicassetsContract.actions
+				.transfer(["alice", "ezstake", ["1099511627776", "1099511627777", "1099511627778"], "stake"])
+				.send("alice@active");
+			// stake some assets for bob
+			await atomicassetsContract.actions.transfer(["bob", "ezstake", ["1099511627780"], "stake"]).send("bob@active");
+		});
+
+		it("require user auth", () => {
+			return assert.isRejected(
+				ezstakeContract.actions.unstakeall(["alice", 0, 10]).send("bob@active"),
+				"user alice has not authorized this action"
+			);
+		});
+
+		it("disallow zero max_rows", () => {
+			return assert.isRejected(ezstakeContract.actions.unstakeall(["alice", 0, 0]).send("alice@active"), "max_rows must be positive");
+		});
+
+		it("disallow while in cooldown", () => {
+			// set blockchain time
+			// 5 seconds after staking
+			blockchain.setTime(TimePointSec.fromString("2022-01-01T00:00:05"));
+
+			return assert.isRejected(ezstakeContract.actions.unstakeall(["alice", 0, 10]).send("alice@active"), "nothing to unstake");
+		});
+
+		describe("table storage", () => {
+			it("update rows in batches", async () => {
+				// set blockchain time for unstaking
+				blockchain.setTime(TimePointSec.fromString("2022-01-04T00:00:00"));
+
+				await ezstakeContract.actions.unstakeall(["alice", 0, 2]).send("alice@active");
+
+				let [player] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+				let assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(player.value, { user: "alice", hourly_rate: "1.00000000 WAX" });
+				assert.deepEqual(
+					assets.map((row) => row.value.asset_id),
+					["1099511627778", "1099511627780"]
+				);
+				assert.deepEqual(getLogs("logunstake"), [
+					{
+						user: "alice",
+						asset_ids: ["1099511627776", "1099511627777"],
+						removed_rate: "2.00000000 WAX",
+						hourly_rate: "1.00000000 WAX",
+						total_power: "200000000",
+					},
+				]);
+
+				await ezstakeContract.actions.unstakeall(["alice", 0, 2]).send("alice@active");
+
+				[player] = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "users", ezstakeContract.name.toString());
+				assets = getTableRows<any[]>(blockchain, ezstakeContract.name.toString(), "assets", ezstakeContract.name.toString());
+
+				assert.deepEqual(player.value, { user: "alice", hourly_rate: "0.00000000 WAX" });
+				assert.deepEqual(
+					assets.map((row) => row.value.asset_id),
+					["1099511627780"]
+				);
+				assert.deepEqual(getLogs("logunstake"), [
+					{
+						user: "alice",
+						asset_ids: ["1099511627778"],
+						removed_rate: "1.00000000 WAX",
+						hourly_rate: "0.00000000 WAX",
+						total_power: "100000000",
+					},
+				]);
+			});
+		});
+	});
 });